@@ -0,0 +1,726 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <latch>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <span>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cochan/cochan.hpp>
+
+// Every allocation in the process is counted, so runs can report allocations per message
+static std::atomic_uint64_t allocations = 0;
+
+void* operator new( std::size_t size )
+{
+    allocations.fetch_add( 1, std::memory_order_relaxed );
+    if( void* memory = std::malloc( size != 0 ? size : 1 ) )
+    {
+        return memory;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void* operator new( std::size_t size, std::align_val_t alignment )
+{
+    allocations.fetch_add( 1, std::memory_order_relaxed );
+    const auto align = static_cast< std::size_t >( alignment );
+    if( void* memory = std::aligned_alloc( align, ( size + align - 1 ) / align * align ) )
+    {
+        return memory;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void operator delete( void* memory ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete( void* memory, std::size_t ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete( void* memory, std::align_val_t ) noexcept
+{
+    std::free( memory );
+}
+
+void operator delete( void* memory, std::size_t, std::align_val_t ) noexcept
+{
+    std::free( memory );
+}
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+// Fire-and-forget coroutine. Starts suspended so it can be launched on any thread,
+// destroys itself when done and counts down its latch.
+struct Task
+{
+    struct promise_type
+    {
+        Task get_return_object()
+        {
+            return Task{ std::coroutine_handle< promise_type >::from_promise( *this ) };
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        auto final_suspend() noexcept
+        {
+            struct Finish
+            {
+                bool await_ready() noexcept
+                {
+                    return false;
+                }
+
+                void await_suspend( std::coroutine_handle< promise_type > handle ) noexcept
+                {
+                    std::latch* done = handle.promise().done;
+                    handle.destroy();
+                    done->count_down();
+                }
+
+                void await_resume() noexcept
+                {
+                }
+            };
+
+            return Finish{};
+        }
+
+        void return_void()
+        {
+        }
+
+        void unhandled_exception()
+        {
+            std::terminate();
+        }
+
+        std::latch* done = nullptr;
+    };
+
+    std::coroutine_handle< promise_type > handle;
+};
+
+class ThreadPool
+{
+  public:
+    explicit ThreadPool( std::size_t threadCount )
+    {
+        for( std::size_t i = 0; i < threadCount; i++ )
+        {
+            workers.emplace_back( [ this ]() {
+                run();
+            } );
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            const std::lock_guard< std::mutex > guard( mutex );
+            stopping = true;
+        }
+
+        condition.notify_all();
+        for( auto& worker : workers )
+        {
+            worker.join();
+        }
+    }
+
+    void post( std::coroutine_handle<> handle )
+    {
+        {
+            const std::lock_guard< std::mutex > guard( mutex );
+            queue.push_back( handle );
+        }
+
+        condition.notify_one();
+    }
+
+    void postBatch( std::span< std::coroutine_handle<> > handles )
+    {
+        {
+            const std::lock_guard< std::mutex > guard( mutex );
+            queue.insert( queue.end(), handles.begin(), handles.end() );
+        }
+
+        condition.notify_all();
+    }
+
+  private:
+    void run()
+    {
+        while( true )
+        {
+            std::unique_lock< std::mutex > guard( mutex );
+            condition.wait( guard, [ this ]() {
+                return stopping || !queue.empty();
+            } );
+
+            if( queue.empty() )
+            {
+                return;
+            }
+
+            const auto handle = queue.front();
+            queue.pop_front();
+            guard.unlock();
+
+            handle.resume();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque< std::coroutine_handle<> > queue;
+    bool stopping = false;
+    std::vector< std::thread > workers;
+};
+
+struct PoolScheduler
+{
+    void schedule( std::coroutine_handle<> handle )
+    {
+        pool->post( handle );
+    }
+
+    void scheduleBatch( std::span< std::coroutine_handle<> > handles )
+    {
+        pool->postBatch( handles );
+    }
+
+    ThreadPool* pool;
+};
+
+// Inline runs start every coroutine on a thread of its own, after that they run wherever they are woken.
+// Pool runs post them to the pool.
+struct InlineLauncher
+{
+    using Scheduler = cochan::ScheduleFunc;
+    static constexpr const char* name = "inline";
+
+    Scheduler scheduler() const
+    {
+        return cochan::defaultScheduleFunc;
+    }
+
+    void launch( std::coroutine_handle<> handle )
+    {
+        threads.emplace_back( [ handle ]() {
+            handle.resume();
+        } );
+    }
+
+    void join()
+    {
+        for( auto& thread : threads )
+        {
+            thread.join();
+        }
+
+        threads.clear();
+    }
+
+    std::vector< std::thread > threads;
+};
+
+struct PoolLauncher
+{
+    using Scheduler = PoolScheduler;
+    static constexpr const char* name = "pool";
+
+    Scheduler scheduler() const
+    {
+        return PoolScheduler{ pool };
+    }
+
+    void launch( std::coroutine_handle<> handle )
+    {
+        pool->post( handle );
+    }
+
+    void join()
+    {
+    }
+
+    ThreadPool* pool;
+};
+
+template< class Sender >
+Task produce( Sender sender, std::uint64_t count )
+{
+    for( std::uint64_t i = 0; i < count; i++ )
+    {
+        co_await sender.send( i );
+    }
+}
+
+template< class Receiver >
+Task consume( Receiver receiver, std::atomic_uint64_t& received )
+{
+    std::uint64_t count = 0;
+    while( true )
+    {
+        auto value = co_await receiver.receive();
+        if( !value )
+        {
+            break;
+        }
+
+        count++;
+    }
+
+    received.fetch_add( count, std::memory_order_relaxed );
+}
+
+template< class Receiver, class Sender >
+Task pong( Receiver requests, Sender replies )
+{
+    while( true )
+    {
+        auto value = co_await requests.receive();
+        if( !value )
+        {
+            break;
+        }
+
+        co_await replies.send( *value );
+    }
+}
+
+template< class Sender, class Receiver, class Histogram >
+Task ping( Sender requests, Receiver replies, std::uint64_t rounds, Histogram& histogram )
+{
+    for( std::uint64_t i = 0; i < rounds; i++ )
+    {
+        const auto start = Clock::now();
+        co_await requests.send( i );
+        auto reply = co_await replies.receive();
+        histogram.record( std::chrono::duration_cast< std::chrono::nanoseconds >( Clock::now() - start ).count() );
+        if( !reply )
+        {
+            break;
+        }
+    }
+}
+
+template< class Receiver >
+Task parkOnce( Receiver receiver )
+{
+    auto value = co_await receiver.receive();
+    (void)value;
+}
+
+template< class Sender >
+Task parkSendOnce( Sender sender, std::uint64_t value )
+{
+    co_await sender.send( value );
+}
+
+// Log-linear buckets in the spirit of HdrHistogram: 2^subBits buckets per power of two, so every
+// recorded value is within 1 / 2^subBits of the bucket it lands in. Recording never allocates.
+class LatencyHistogram
+{
+  public:
+    void record( std::int64_t nanoseconds )
+    {
+        const auto value = static_cast< std::uint64_t >( nanoseconds < 0 ? 0 : nanoseconds );
+        buckets[ bucketOf( value ) ]++;
+        total++;
+        max = std::max( max, value );
+    }
+
+    // Upper bound of the bucket holding the given percentile
+    std::uint64_t percentile( double percent ) const
+    {
+        const auto rank = static_cast< std::uint64_t >( percent / 100.0 * static_cast< double >( total ) );
+        std::uint64_t seen = 0;
+        for( std::size_t i = 0; i < buckets.size(); i++ )
+        {
+            seen += buckets[ i ];
+            if( seen > rank )
+            {
+                return std::min( upperBound( i ), max );
+            }
+        }
+
+        return max;
+    }
+
+    std::uint64_t maximum() const
+    {
+        return max;
+    }
+
+    std::uint64_t count() const
+    {
+        return total;
+    }
+
+  private:
+    static constexpr std::size_t subBits = 4;
+    static constexpr std::size_t subCount = std::size_t{ 1 } << subBits;
+
+    static std::size_t bucketOf( std::uint64_t value )
+    {
+        if( value < subCount )
+        {
+            return value;
+        }
+
+        const std::size_t magnitude = std::bit_width( value ) - 1;
+        const std::size_t sub = ( value >> ( magnitude - subBits ) ) & ( subCount - 1 );
+        return ( magnitude - subBits + 1 ) * subCount + sub;
+    }
+
+    static std::uint64_t upperBound( std::size_t bucket )
+    {
+        if( bucket < subCount )
+        {
+            return bucket;
+        }
+
+        const std::size_t magnitude = bucket / subCount + subBits - 1;
+        const std::uint64_t sub = bucket % subCount;
+        return ( ( subCount + sub + 1 ) << ( magnitude - subBits ) ) - 1;
+    }
+
+    std::array< std::uint64_t, ( 64 - subBits + 1 ) * subCount > buckets{};
+    std::uint64_t total = 0;
+    std::uint64_t max = 0;
+};
+
+enum class Topology
+{
+    Spsc,
+    Mpsc,
+    Spmc,
+    Mpmc,
+};
+
+const char* nameOf( Topology topology )
+{
+    switch( topology )
+    {
+        case Topology::Spsc:
+            return "spsc";
+        case Topology::Mpsc:
+            return "mpsc";
+        case Topology::Spmc:
+            return "spmc";
+        case Topology::Mpmc:
+            return "mpmc";
+    }
+
+    return "";
+}
+
+struct Options
+{
+    bool quick = false;
+    std::size_t maxThreads = std::max( 1u, std::thread::hardware_concurrency() );
+    std::string out;
+};
+
+// Results are appended as JSON objects, one array per suite
+class Report
+{
+  public:
+    void add( const std::string& suite, const std::string& object )
+    {
+        auto& entries = suite == "throughput" ? throughput : suite == "latency" ? latency : close;
+        entries.push_back( object );
+        std::cerr << suite << ": " << object << std::endl;
+    }
+
+    std::string json( const Options& options ) const
+    {
+        std::ostringstream out;
+        out << "{\n  \"hardwareThreads\": " << std::thread::hardware_concurrency() << ",\n  \"maxThreads\": " << options.maxThreads
+            << ",\n  \"quick\": " << ( options.quick ? "true" : "false" ) << ",\n";
+        writeArray( out, "throughput", throughput );
+        out << ",\n";
+        writeArray( out, "latency", latency );
+        out << ",\n";
+        writeArray( out, "close", close );
+        out << "\n}\n";
+        return out.str();
+    }
+
+  private:
+    static void writeArray( std::ostringstream& out, const char* name, const std::vector< std::string >& entries )
+    {
+        out << "  \"" << name << "\": [";
+        for( std::size_t i = 0; i < entries.size(); i++ )
+        {
+            out << ( i == 0 ? "\n    " : ",\n    " ) << entries[ i ];
+        }
+
+        out << ( entries.empty() ? "]" : "\n  ]" );
+    }
+
+    std::vector< std::string > throughput;
+    std::vector< std::string > latency;
+    std::vector< std::string > close;
+};
+
+template< class Launcher, class Chan >
+void runThroughput( Launcher& launcher, Report& report, Topology topology, std::tuple< cochan::Sender< std::uint64_t, Chan >, cochan::Receiver< std::uint64_t, Chan > > endpoints,
+    std::size_t capacity, std::size_t producers, std::size_t consumers, std::uint64_t messages )
+{
+    auto [ sender, receiver ] = std::move( endpoints );
+    const std::uint64_t perProducer = messages / producers;
+    std::atomic_uint64_t received = 0;
+    std::latch done( static_cast< std::ptrdiff_t >( producers + consumers ) );
+
+    const auto allocationsBefore = allocations.load( std::memory_order_relaxed );
+    const auto start = Clock::now();
+    for( std::size_t i = 0; i < consumers; i++ )
+    {
+        auto task = consume( receiver, received );
+        task.handle.promise().done = &done;
+        launcher.launch( task.handle );
+    }
+
+    for( std::size_t i = 0; i < producers; i++ )
+    {
+        auto task = produce( sender, perProducer );
+        task.handle.promise().done = &done;
+        launcher.launch( task.handle );
+    }
+
+    {
+        auto dropSender = std::move( sender );
+        auto dropReceiver = std::move( receiver );
+    }
+
+    done.wait();
+    const double seconds = std::chrono::duration< double >( Clock::now() - start ).count();
+    const auto allocated = allocations.load( std::memory_order_relaxed ) - allocationsBefore;
+    launcher.join();
+
+    const auto total = received.load();
+    std::ostringstream out;
+    out << "{\"scheduler\": \"" << Launcher::name << "\", \"topology\": \"" << nameOf( topology ) << "\", \"capacity\": " << capacity
+        << ", \"producers\": " << producers << ", \"consumers\": " << consumers << ", \"messages\": " << total << ", \"seconds\": " << seconds
+        << ", \"messagesPerSecond\": " << static_cast< double >( total ) / seconds
+        << ", \"allocationsPerMessage\": " << static_cast< double >( allocated ) / static_cast< double >( total ? total : 1 ) << "}";
+    report.add( "throughput", out.str() );
+}
+
+template< class Launcher >
+void throughputSuite( Launcher& launcher, Report& report, const Options& options )
+{
+    using Scheduler = typename Launcher::Scheduler;
+    const std::uint64_t messages = options.quick ? 20000 : 400000;
+
+    std::vector< std::size_t > threadCounts;
+    for( std::size_t threads = 1; threads <= options.maxThreads; threads *= 2 )
+    {
+        threadCounts.push_back( threads );
+    }
+
+    for( std::size_t capacity : { 1, 16, 256, 4096 } )
+    {
+        runThroughput( launcher, report, Topology::Spsc, cochan::makeSpscChannel< std::uint64_t, Scheduler >( capacity, launcher.scheduler() ), capacity, 1, 1,
+            messages );
+
+        for( std::size_t threads : threadCounts )
+        {
+            runThroughput( launcher, report, Topology::Mpsc, cochan::makeChannel< std::uint64_t, Scheduler >( capacity, launcher.scheduler() ), capacity, threads,
+                1, messages );
+            runThroughput( launcher, report, Topology::Spmc, cochan::makeChannel< std::uint64_t, Scheduler >( capacity, launcher.scheduler() ), capacity, 1,
+                threads, messages );
+            runThroughput( launcher, report, Topology::Mpmc, cochan::makeChannel< std::uint64_t, Scheduler >( capacity, launcher.scheduler() ), capacity,
+                threads, threads, messages );
+        }
+    }
+}
+
+template< class Launcher >
+void latencySuite( Launcher& launcher, Report& report, const Options& options )
+{
+    using Scheduler = typename Launcher::Scheduler;
+    const std::uint64_t rounds = options.quick ? 10000 : 200000;
+
+    for( std::size_t capacity : { 0, 1 } )
+    {
+        auto [ requestSender, requestReceiver ] = cochan::makeChannel< std::uint64_t, Scheduler >( capacity, launcher.scheduler() );
+        auto [ replySender, replyReceiver ] = cochan::makeChannel< std::uint64_t, Scheduler >( capacity, launcher.scheduler() );
+
+        LatencyHistogram histogram;
+        std::latch done( 2 );
+        {
+            auto task = pong( std::move( requestReceiver ), std::move( replySender ) );
+            task.handle.promise().done = &done;
+            launcher.launch( task.handle );
+        }
+
+        {
+            auto task = ping( std::move( requestSender ), std::move( replyReceiver ), rounds, histogram );
+            task.handle.promise().done = &done;
+            launcher.launch( task.handle );
+        }
+
+        done.wait();
+        launcher.join();
+
+        std::ostringstream out;
+        out << "{\"scheduler\": \"" << Launcher::name << "\", \"capacity\": " << capacity << ", \"rounds\": " << histogram.count()
+            << ", \"p50Ns\": " << histogram.percentile( 50 ) << ", \"p90Ns\": " << histogram.percentile( 90 ) << ", \"p99Ns\": " << histogram.percentile( 99 )
+            << ", \"p999Ns\": " << histogram.percentile( 99.9 ) << ", \"maxNs\": " << histogram.maximum() << "}";
+        report.add( "latency", out.str() );
+    }
+}
+
+// Time from dropping the last endpoint of one side until every coroutine parked on the other side has resumed.
+// Senders park on an unbuffered channel and have their values dropped on close.
+template< class Launcher >
+double closeOnce( Launcher& launcher, std::size_t parked, bool parkSenders )
+{
+    using Scheduler = typename Launcher::Scheduler;
+    auto [ sender, receiver ] = cochan::makeChannel< std::uint64_t, Scheduler >( parkSenders ? 0 : 16, launcher.scheduler() );
+    std::latch done( static_cast< std::ptrdiff_t >( parked ) );
+    for( std::size_t i = 0; i < parked; i++ )
+    {
+        // Parks right away on this thread, wakes up through the scheduler
+        auto task = parkSenders ? parkSendOnce( sender, i ) : parkOnce( receiver );
+        task.handle.promise().done = &done;
+        task.handle.resume();
+    }
+
+    Clock::time_point start;
+    if( parkSenders )
+    {
+        {
+            auto dropSender = std::move( sender );
+        }
+
+        start = Clock::now();
+        auto dropReceiver = std::move( receiver );
+    }
+    else
+    {
+        {
+            auto dropReceiver = std::move( receiver );
+        }
+
+        start = Clock::now();
+        auto dropSender = std::move( sender );
+    }
+
+    done.wait();
+    return std::chrono::duration< double, std::micro >( Clock::now() - start ).count();
+}
+
+template< class Launcher >
+void closeSuite( Launcher& launcher, Report& report, const Options& options )
+{
+    for( bool parkSenders : { false, true } )
+    {
+        for( std::size_t parked : { std::size_t{ 1000 }, std::size_t{ options.quick ? 10000u : 100000u } } )
+        {
+            const double microseconds = closeOnce( launcher, parked, parkSenders );
+
+            std::ostringstream out;
+            out << "{\"scheduler\": \"" << Launcher::name << "\", \"" << ( parkSenders ? "parkedSenders" : "parkedReceivers" ) << "\": " << parked
+                << ", \"microseconds\": " << microseconds << ", \"nanosecondsPerWaiter\": " << microseconds * 1000.0 / static_cast< double >( parked ) << "}";
+            report.add( "close", out.str() );
+        }
+    }
+}
+
+template< class Launcher >
+void runSuites( Launcher& launcher, Report& report, const Options& options )
+{
+    throughputSuite( launcher, report, options );
+    latencySuite( launcher, report, options );
+    closeSuite( launcher, report, options );
+}
+
+Options parse( int argc, char** argv )
+{
+    Options options;
+    for( int i = 1; i < argc; i++ )
+    {
+        const std::string arg = argv[ i ];
+        if( arg == "--quick" )
+        {
+            options.quick = true;
+        }
+        else if( arg == "--threads" && i + 1 < argc )
+        {
+            options.maxThreads = std::max( 1ul, std::strtoul( argv[ ++i ], nullptr, 10 ) );
+        }
+        else if( arg == "--out" && i + 1 < argc )
+        {
+            options.out = argv[ ++i ];
+        }
+        else
+        {
+            std::cerr << "Usage: cochan_bench [--quick] [--threads N] [--out results.json]" << std::endl;
+            std::exit( arg == "--help" ? 0 : 1 );
+        }
+    }
+
+    return options;
+}
+
+} // namespace
+
+// Writes JSON to stdout or --out, progress goes to stderr
+int main( int argc, char** argv )
+{
+    const Options options = parse( argc, argv );
+    Report report;
+
+    {
+        InlineLauncher launcher;
+        runSuites( launcher, report, options );
+    }
+
+    {
+        ThreadPool pool( options.maxThreads );
+        PoolLauncher launcher{ &pool };
+        runSuites( launcher, report, options );
+    }
+
+    const auto json = report.json( options );
+    if( options.out.empty() )
+    {
+        std::cout << json;
+        return 0;
+    }
+
+    std::ofstream( options.out ) << json;
+    return 0;
+}
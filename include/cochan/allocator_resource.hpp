@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+#include <cochan/utils.hpp>
+
+namespace cochan
+{
+
+// Adapts a standard allocator to std::pmr::memory_resource so it can be passed to makeChannel and friends.
+// Memory is handed out in cache-line sized units, which covers every alignment the channels ask for.
+// The adapter must outlive every channel allocated through it.
+template< class Allocator >
+class AllocatorResource: public std::pmr::memory_resource
+{
+  public:
+    explicit AllocatorResource( const Allocator& theAllocator = Allocator{} )
+        : allocator( theAllocator )
+    {
+    }
+
+  protected:
+    void* do_allocate( std::size_t bytes, std::size_t alignment ) override
+    {
+        COCHAN_ASSERT( alignment <= alignof( Unit ), "Alignment is not supported by AllocatorResource" );
+        return std::allocator_traits< UnitAllocator >::allocate( allocator, units( bytes ) );
+    }
+
+    void do_deallocate( void* pointer, std::size_t bytes, std::size_t ) override
+    {
+        std::allocator_traits< UnitAllocator >::deallocate( allocator, static_cast< Unit* >( pointer ), units( bytes ) );
+    }
+
+    bool do_is_equal( const std::pmr::memory_resource& other ) const noexcept override
+    {
+        auto* resource = dynamic_cast< const AllocatorResource* >( &other );
+        return resource && resource->allocator == allocator;
+    }
+
+  private:
+    struct alignas( cacheLineSize ) Unit
+    {
+        std::byte bytes[ cacheLineSize ];
+    };
+
+    using UnitAllocator = typename std::allocator_traits< Allocator >::template rebind_alloc< Unit >;
+
+    static std::size_t units( std::size_t bytes )
+    {
+        return bytes == 0 ? 1 : ( bytes + sizeof( Unit ) - 1 ) / sizeof( Unit );
+    }
+
+    UnitAllocator allocator;
+};
+
+} // namespace cochan
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <array>
+#include <new>
+#include <memory_resource>
+#include <utility>
+
+namespace cochan
+{
+
+// Memory resource that keeps freed blocks in per-thread free lists instead of handing them back to the global
+// allocator, so channels created and dropped per request stop paying for a malloc/free round trip each time.
+// Blocks are rounded up to a size class and all come from ::operator new with the same alignment, so a block
+// freed on one thread can be reused by any other. Larger or over-aligned requests go straight to ::operator new.
+class BlockPool: public std::pmr::memory_resource
+{
+  public:
+    static constexpr std::size_t blockAlignment = 64;
+    static constexpr std::size_t classCount = 64;
+    static constexpr std::size_t maxBlockSize = classCount * blockAlignment;
+
+    // Up to maxCached blocks of each size class are kept per thread. The limit applies to the thread's cache as a
+    // whole, which all pools share, so a thread using several pools caches at most the largest of their limits
+    explicit BlockPool( std::size_t theMaxCached = 16 )
+        : maxCached( theMaxCached )
+    {
+    }
+
+  protected:
+    void* do_allocate( std::size_t bytes, std::size_t alignment ) override
+    {
+        if( bytes == 0 || bytes > maxBlockSize || alignment > blockAlignment )
+        {
+            return std::pmr::new_delete_resource()->allocate( bytes, alignment );
+        }
+
+        Cache* cache = localCache();
+        const std::size_t index = ( bytes - 1 ) / blockAlignment;
+        if( cache && cache->lists[ index ].head )
+        {
+            auto& list = cache->lists[ index ];
+            Block* block = list.head;
+            list.head = block->next;
+            list.count--;
+            return block;
+        }
+
+        return ::operator new( ( index + 1 ) * blockAlignment, std::align_val_t{ blockAlignment } );
+    }
+
+    void do_deallocate( void* pointer, std::size_t bytes, std::size_t alignment ) override
+    {
+        if( bytes == 0 || bytes > maxBlockSize || alignment > blockAlignment )
+        {
+            std::pmr::new_delete_resource()->deallocate( pointer, bytes, alignment );
+            return;
+        }
+
+        Cache* cache = localCache();
+        auto* list = cache ? &cache->lists[ ( bytes - 1 ) / blockAlignment ] : nullptr;
+        if( !list || list->count >= maxCached )
+        {
+            ::operator delete( pointer, std::align_val_t{ blockAlignment } );
+            return;
+        }
+
+        list->head = new( pointer ) Block{ list->head };
+        list->count++;
+    }
+
+    bool do_is_equal( const std::pmr::memory_resource& other ) const noexcept override
+    {
+        return dynamic_cast< const BlockPool* >( &other ) != nullptr;
+    }
+
+  private:
+    struct Block
+    {
+        Block* next;
+    };
+
+    struct FreeList
+    {
+        Block* head = nullptr;
+        std::size_t count = 0;
+    };
+
+    struct Cache
+    {
+        ~Cache()
+        {
+            for( auto& list : lists )
+            {
+                while( list.head )
+                {
+                    ::operator delete( std::exchange( list.head, list.head->next ), std::align_val_t{ blockAlignment } );
+                }
+            }
+
+            destroyed = true;
+        }
+
+        std::array< FreeList, classCount > lists;
+    };
+
+    // Shared by all pools, their blocks are interchangeable. nullptr once the thread is tearing down
+    static Cache* localCache()
+    {
+        if( destroyed )
+        {
+            return nullptr;
+        }
+
+        thread_local Cache cache;
+        return &cache;
+    }
+
+    static inline thread_local bool destroyed = false;
+
+    const std::size_t maxCached;
+};
+
+// Pool for makeChannel and friends, e.g. makeChannel< T >( capacity, defaultScheduleFunc, blockPool() )
+inline BlockPool* blockPool()
+{
+    static BlockPool pool;
+    return &pool;
+}
+
+} // namespace cochan
@@ -0,0 +1,728 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <coroutine>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <cochan/utils.hpp>
+#include <cochan/waiter_list.hpp>
+#include <cochan/scheduler.hpp>
+#include <cochan/channel.hpp>
+
+namespace cochan
+{
+
+// What happens when a subscriber falls a whole ring behind
+enum class LagPolicy
+{
+    // Senders park until the slowest subscriber has read the oldest message
+    Backpressure,
+    // Senders overwrite the oldest message, subscribers that missed it get TryResult::Lagged
+    Overwrite,
+};
+
+// Message is shared by all subscribers, nobody copies it. status is TryResult::Ok with value set,
+// TryResult::Lagged with the number of messages skipped, TryResult::Closed, or TryResult::Empty for tryReceive.
+template< class T >
+struct BroadcastResult
+{
+    TryResult status;
+    std::shared_ptr< const T > value;
+    std::uint64_t lagged = 0;
+};
+
+template< class T, class Scheduler >
+class BroadcastSender;
+
+template< class T, class Scheduler >
+class BroadcastReceiver;
+
+// One ring of messages, each read by every subscriber through its own cursor. Message number seq lives in
+// slots[ seq % capacity ] until every subscriber that was there when it was sent has read it, or, with
+// LagPolicy::Overwrite, until a newer message takes its slot.
+template< class T, class Scheduler >
+class BroadcastChannel
+{
+  public:
+    using Sender = BroadcastSender< T, Scheduler >;
+    using Receiver = BroadcastReceiver< T, Scheduler >;
+
+    static std::tuple< Sender, Receiver > open(
+        std::pmr::memory_resource* resource, std::size_t capacity, LagPolicy policy, const Scheduler& scheduler )
+    {
+        COCHAN_ASSERT_FORMAT( capacity != 0, "Broadcast capacity must be greater than 0" );
+
+        void* memory = resource->allocate( sizeof( BroadcastChannel ), alignof( BroadcastChannel ) );
+        BroadcastChannel* chan;
+        try
+        {
+            chan = new( memory ) BroadcastChannel( resource, capacity, policy, scheduler );
+        }
+        catch( ... )
+        {
+            resource->deallocate( memory, sizeof( BroadcastChannel ), alignof( BroadcastChannel ) );
+            throw;
+        }
+
+        Sender sender( chan );
+        Receiver receiver( chan, nullptr );
+        return { std::move( sender ), std::move( receiver ) };
+    }
+
+    std::size_t getCapacity() const
+    {
+        return slots.size();
+    }
+
+  private:
+    struct Slot
+    {
+        std::shared_ptr< const T > value;
+        // Subscribers yet to read it, only tracked with LagPolicy::Backpressure
+        std::size_t pending = 0;
+    };
+
+    struct SendWaiter
+    {
+        bool release()
+        {
+            return true;
+        }
+
+        std::shared_ptr< const T >* value = nullptr;
+        TryResult* status = nullptr;
+        std::coroutine_handle<> handle;
+        SendWaiter* next = nullptr;
+        SendWaiter* prev = nullptr;
+    };
+
+    struct ReceiveWaiter
+    {
+        bool release()
+        {
+            return true;
+        }
+
+        Receiver* receiver = nullptr;
+        BroadcastResult< T >* result = nullptr;
+        std::coroutine_handle<> handle;
+        ReceiveWaiter* next = nullptr;
+        ReceiveWaiter* prev = nullptr;
+    };
+
+    BroadcastChannel( std::pmr::memory_resource* theResource, std::size_t capacity, LagPolicy thePolicy, const Scheduler& theScheduler )
+        : resource( theResource )
+        , scheduler( theScheduler )
+        , policy( thePolicy )
+        , slots( capacity, theResource )
+    {
+    }
+
+    BroadcastChannel( const BroadcastChannel& ) = delete;
+    BroadcastChannel( BroadcastChannel&& ) = delete;
+
+    template< class U >
+    std::shared_ptr< const T > makeMessage( U&& value )
+    {
+        return std::allocate_shared< const T >( std::pmr::polymorphic_allocator< T >( resource ), std::forward< U >( value ) );
+    }
+
+    std::uint64_t oldest() const
+    {
+        return tail > slots.size() ? tail - slots.size() : 0;
+    }
+
+    bool writable() const
+    {
+        return policy == LagPolicy::Overwrite || tail < slots.size() || slots[ tail % slots.size() ].pending == 0;
+    }
+
+    void pushLocked( std::shared_ptr< const T >&& value )
+    {
+        Slot& slot = slots[ tail % slots.size() ];
+        slot.value = std::move( value );
+        slot.pending = receivers;
+        tail++;
+    }
+
+    // Returns false if there is nothing for receiver yet
+    bool readLocked( Receiver& receiver, BroadcastResult< T >& result )
+    {
+        if( receiver.cursor < oldest() )
+        {
+            result = { TryResult::Lagged, nullptr, oldest() - receiver.cursor };
+            receiver.cursor = oldest();
+            return true;
+        }
+
+        if( receiver.cursor == tail )
+        {
+            if( senders != 0 || awaitableSenders != 0 )
+            {
+                return false;
+            }
+
+            result = { TryResult::Closed, nullptr };
+            return true;
+        }
+
+        Slot& slot = slots[ receiver.cursor++ % slots.size() ];
+        result = { TryResult::Ok, slot.value };
+        if( policy == LagPolicy::Backpressure )
+        {
+            consume( slot );
+        }
+
+        return true;
+    }
+
+    void consume( Slot& slot )
+    {
+        if( --slot.pending == 0 )
+        {
+            slot.value.reset();
+        }
+    }
+
+    // Pushes parked senders' messages while there is room and hands them to parked receivers, until neither moves
+    void flushLocked( WaiterList< SendWaiter >& releasedSenders, WaiterList< ReceiveWaiter >& releasedReceivers )
+    {
+        bool progress = true;
+        while( progress )
+        {
+            progress = false;
+            while( !senderWaiters.empty() && writable() )
+            {
+                SendWaiter* sender = senderWaiters.pop_front();
+                pushLocked( std::move( *sender->value ) );
+                *sender->status = TryResult::Ok;
+                releasedSenders.push_back( sender );
+                progress = true;
+            }
+
+            // Parked receivers are all caught up, if one has nothing to read none has
+            while( ReceiveWaiter* receiver = receiverWaiters.front() )
+            {
+                if( !readLocked( *receiver->receiver, *receiver->result ) )
+                {
+                    break;
+                }
+
+                receiverWaiters.pop_front();
+                releasedReceivers.push_back( receiver );
+                progress = true;
+            }
+        }
+    }
+
+    // Woken coroutines may destroy the channel, don't touch it after the first wake
+    void unlockAndSchedule(
+        std::unique_lock< std::mutex >& guard, WaiterList< SendWaiter >& releasedSenders, WaiterList< ReceiveWaiter >& releasedReceivers )
+    {
+        Scheduler schedule = scheduler;
+        guard.unlock();
+
+        scheduleAll( schedule, releasedReceivers );
+        scheduleAll( schedule, releasedSenders );
+    }
+
+    // Returns whether sender got parked
+    bool handleSend( SendWaiter& sender )
+    {
+        std::unique_lock< std::mutex > guard( mutex );
+        if( receivers == 0 )
+        {
+            *sender.status = TryResult::Closed;
+            return false;
+        }
+
+        if( !writable() )
+        {
+            senderWaiters.push_back( &sender );
+            return true;
+        }
+
+        pushLocked( std::move( *sender.value ) );
+        *sender.status = TryResult::Ok;
+
+        WaiterList< SendWaiter > releasedSenders;
+        WaiterList< ReceiveWaiter > releasedReceivers;
+        flushLocked( releasedSenders, releasedReceivers );
+        unlockAndSchedule( guard, releasedSenders, releasedReceivers );
+        return false;
+    }
+
+    // The message is only made once it is known to fit
+    template< class U >
+    TryResult trySend( U&& value )
+    {
+        std::unique_lock< std::mutex > guard( mutex );
+        if( receivers == 0 )
+        {
+            return TryResult::Closed;
+        }
+
+        if( !writable() )
+        {
+            return TryResult::Full;
+        }
+
+        pushLocked( makeMessage( std::forward< U >( value ) ) );
+
+        WaiterList< SendWaiter > releasedSenders;
+        WaiterList< ReceiveWaiter > releasedReceivers;
+        flushLocked( releasedSenders, releasedReceivers );
+        unlockAndSchedule( guard, releasedSenders, releasedReceivers );
+        return TryResult::Ok;
+    }
+
+    // Returns whether receiver got parked
+    bool handleReceive( ReceiveWaiter& receiver )
+    {
+        std::unique_lock< std::mutex > guard( mutex );
+        if( !readLocked( *receiver.receiver, *receiver.result ) )
+        {
+            receiverWaiters.push_back( &receiver );
+            return true;
+        }
+
+        WaiterList< SendWaiter > releasedSenders;
+        WaiterList< ReceiveWaiter > releasedReceivers;
+        flushLocked( releasedSenders, releasedReceivers );
+        unlockAndSchedule( guard, releasedSenders, releasedReceivers );
+        return false;
+    }
+
+    BroadcastResult< T > tryReceive( Receiver& receiver )
+    {
+        BroadcastResult< T > result{ TryResult::Empty, nullptr };
+        std::unique_lock< std::mutex > guard( mutex );
+        if( !readLocked( receiver, result ) )
+        {
+            return result;
+        }
+
+        WaiterList< SendWaiter > releasedSenders;
+        WaiterList< ReceiveWaiter > releasedReceivers;
+        flushLocked( releasedSenders, releasedReceivers );
+        unlockAndSchedule( guard, releasedSenders, releasedReceivers );
+        return result;
+    }
+
+    void addSender()
+    {
+        std::lock_guard< std::mutex > guard( mutex );
+        senders++;
+    }
+
+    // Awaitables keep the channel alive while parked, and a pending send keeps it open for receivers
+    void addAwaitableSender()
+    {
+        std::lock_guard< std::mutex > guard( mutex );
+        awaitableSenders++;
+    }
+
+    void addAwaitableReceiver()
+    {
+        std::lock_guard< std::mutex > guard( mutex );
+        awaitableReceivers++;
+    }
+
+    // New subscriber starts where from is, or at the tail without from, and counts as pending for everything still
+    // in the ring from there. Taken under one lock with the registration, so nothing it is owed can be consumed
+    // in between. Returns the cursor
+    std::uint64_t addReceiver( const Receiver* from )
+    {
+        std::lock_guard< std::mutex > guard( mutex );
+        const std::uint64_t cursor = from ? from->cursor : tail;
+        receivers++;
+        if( policy == LagPolicy::Backpressure )
+        {
+            for( auto seq = std::max( cursor, oldest() ); seq < tail; seq++ )
+            {
+                slots[ seq % slots.size() ].pending++;
+            }
+        }
+
+        return cursor;
+    }
+
+    void dropSender()
+    {
+        std::unique_lock< std::mutex > guard( mutex );
+        senders--;
+        releaseSendable( guard );
+    }
+
+    void dropAwaitableSender()
+    {
+        std::unique_lock< std::mutex > guard( mutex );
+        awaitableSenders--;
+        releaseSendable( guard );
+    }
+
+    // Once the last sender or its awaitable is gone, caught up receivers get TryResult::Closed
+    void releaseSendable( std::unique_lock< std::mutex >& guard )
+    {
+        if( senders != 0 || awaitableSenders != 0 )
+        {
+            return;
+        }
+
+        if( ownerless() )
+        {
+            guard.unlock();
+            destroy();
+            return;
+        }
+
+        WaiterList< SendWaiter > releasedSenders;
+        WaiterList< ReceiveWaiter > releasedReceivers;
+        flushLocked( releasedSenders, releasedReceivers );
+        unlockAndSchedule( guard, releasedSenders, releasedReceivers );
+    }
+
+    // Whatever the receiver did not read is consumed on its behalf
+    void dropReceiver( std::uint64_t cursor )
+    {
+        std::unique_lock< std::mutex > guard( mutex );
+        receivers--;
+        if( policy == LagPolicy::Backpressure )
+        {
+            for( auto seq = std::max( cursor, oldest() ); seq < tail; seq++ )
+            {
+                consume( slots[ seq % slots.size() ] );
+            }
+        }
+
+        if( ownerless() )
+        {
+            guard.unlock();
+            destroy();
+            return;
+        }
+
+        WaiterList< SendWaiter > releasedSenders;
+        WaiterList< ReceiveWaiter > releasedReceivers;
+        if( receivers == 0 )
+        {
+            while( SendWaiter* sender = senderWaiters.pop_front() )
+            {
+                *sender->status = TryResult::Closed;
+                releasedSenders.push_back( sender );
+            }
+        }
+        else
+        {
+            flushLocked( releasedSenders, releasedReceivers );
+        }
+
+        unlockAndSchedule( guard, releasedSenders, releasedReceivers );
+    }
+
+    // Parked receive holds its receiver, which is still counted, so there is nothing to wake
+    void dropAwaitableReceiver()
+    {
+        std::unique_lock< std::mutex > guard( mutex );
+        awaitableReceivers--;
+        if( ownerless() )
+        {
+            guard.unlock();
+            destroy();
+        }
+    }
+
+    bool ownerless() const
+    {
+        return senders == 0 && awaitableSenders == 0 && receivers == 0 && awaitableReceivers == 0;
+    }
+
+    void destroy()
+    {
+        std::pmr::memory_resource* memory = resource;
+        std::destroy_at( this );
+        memory->deallocate( this, sizeof( BroadcastChannel ), alignof( BroadcastChannel ) );
+    }
+
+    template< class U, class S >
+    friend class AwaitableBroadcastSend;
+
+    template< class U, class S >
+    friend class AwaitableBroadcastReceive;
+
+    friend Sender;
+    friend Receiver;
+
+    std::pmr::memory_resource* resource;
+    [[no_unique_address]] Scheduler scheduler;
+    const LagPolicy policy;
+
+    std::mutex mutex;
+    std::pmr::vector< Slot > slots;
+    // Number of the next message to be sent
+    std::uint64_t tail = 0;
+    std::size_t senders = 0;
+    std::size_t receivers = 0;
+    std::size_t awaitableSenders = 0;
+    std::size_t awaitableReceivers = 0;
+
+    WaiterList< SendWaiter > senderWaiters;
+    WaiterList< ReceiveWaiter > receiverWaiters;
+};
+
+// Resumes with TryResult::Ok, or TryResult::Closed if every receiver is gone
+template< class T, class Scheduler >
+class AwaitableBroadcastSend
+{
+  public:
+    AwaitableBroadcastSend( const AwaitableBroadcastSend& ) = delete;
+    AwaitableBroadcastSend( AwaitableBroadcastSend&& other ) noexcept
+        : chan( std::exchange( other.chan, nullptr ) )
+        , value( std::move( other.value ) )
+    {
+    }
+
+    ~AwaitableBroadcastSend()
+    {
+        if( chan )
+        {
+            chan->dropAwaitableSender();
+        }
+    }
+
+    AwaitableBroadcastSend& operator=( const AwaitableBroadcastSend& ) = delete;
+    AwaitableBroadcastSend& operator=( AwaitableBroadcastSend&& ) = delete;
+
+    constexpr bool await_ready()
+    {
+        return false;
+    }
+
+    bool await_suspend( std::coroutine_handle<> handle )
+    {
+        waiter.value = &value;
+        waiter.status = &status;
+        waiter.handle = handle;
+        return chan->handleSend( waiter );
+    }
+
+    TryResult await_resume()
+    {
+        return status;
+    }
+
+  private:
+    AwaitableBroadcastSend( BroadcastChannel< T, Scheduler >* theChan, std::shared_ptr< const T >&& theValue )
+        : chan( theChan )
+        , value( std::move( theValue ) )
+    {
+        chan->addAwaitableSender();
+    }
+
+    friend BroadcastSender< T, Scheduler >;
+
+    BroadcastChannel< T, Scheduler >* chan;
+    std::shared_ptr< const T > value;
+    TryResult status = TryResult::Closed;
+    typename BroadcastChannel< T, Scheduler >::SendWaiter waiter;
+};
+
+template< class T, class Scheduler >
+class AwaitableBroadcastReceive
+{
+  public:
+    AwaitableBroadcastReceive( const AwaitableBroadcastReceive& ) = delete;
+    AwaitableBroadcastReceive( AwaitableBroadcastReceive&& other ) noexcept
+        : chan( std::exchange( other.chan, nullptr ) )
+    {
+        waiter.receiver = other.waiter.receiver;
+    }
+
+    ~AwaitableBroadcastReceive()
+    {
+        if( chan )
+        {
+            chan->dropAwaitableReceiver();
+        }
+    }
+
+    AwaitableBroadcastReceive& operator=( const AwaitableBroadcastReceive& ) = delete;
+    AwaitableBroadcastReceive& operator=( AwaitableBroadcastReceive&& ) = delete;
+
+    constexpr bool await_ready()
+    {
+        return false;
+    }
+
+    bool await_suspend( std::coroutine_handle<> handle )
+    {
+        waiter.result = &result;
+        waiter.handle = handle;
+        return chan->handleReceive( waiter );
+    }
+
+    BroadcastResult< T > await_resume()
+    {
+        return std::move( result );
+    }
+
+  private:
+    explicit AwaitableBroadcastReceive( BroadcastReceiver< T, Scheduler >* receiver )
+        : chan( receiver->chan )
+    {
+        waiter.receiver = receiver;
+        chan->addAwaitableReceiver();
+    }
+
+    friend BroadcastReceiver< T, Scheduler >;
+
+    BroadcastChannel< T, Scheduler >* chan;
+    BroadcastResult< T > result{ TryResult::Closed, nullptr };
+    typename BroadcastChannel< T, Scheduler >::ReceiveWaiter waiter;
+};
+
+template< class T, class Scheduler = ScheduleFunc >
+class BroadcastSender
+{
+  public:
+    BroadcastSender() = delete;
+
+    BroadcastSender( const BroadcastSender& other )
+        : chan( other.chan )
+    {
+        chan->addSender();
+    }
+
+    BroadcastSender( BroadcastSender&& other ) noexcept
+        : chan( std::exchange( other.chan, nullptr ) )
+    {
+    }
+
+    ~BroadcastSender()
+    {
+        if( chan )
+        {
+            chan->dropSender();
+        }
+    }
+
+    BroadcastSender& operator=( const BroadcastSender& ) = delete;
+    BroadcastSender& operator=( BroadcastSender&& ) = delete;
+
+    // The message is stored once and shared by every receiver
+    AwaitableBroadcastSend< T, Scheduler > send( T value )
+    {
+        return AwaitableBroadcastSend< T, Scheduler >( chan, chan->makeMessage( std::move( value ) ) );
+    }
+
+    // Never suspends. Full only with LagPolicy::Backpressure, value is moved from only on TryResult::Ok
+    TryResult trySend( T&& value )
+    {
+        return chan->trySend( std::move( value ) );
+    }
+
+    TryResult trySend( const T& value )
+    {
+        return chan->trySend( value );
+    }
+
+    // New receiver that sees messages sent from now on
+    BroadcastReceiver< T, Scheduler > subscribe()
+    {
+        return BroadcastReceiver< T, Scheduler >( chan, nullptr );
+    }
+
+    std::size_t getCapacity() const
+    {
+        return chan->getCapacity();
+    }
+
+  private:
+    explicit BroadcastSender( BroadcastChannel< T, Scheduler >* theChan )
+        : chan( theChan )
+    {
+        chan->addSender();
+    }
+
+    friend BroadcastChannel< T, Scheduler >;
+
+    BroadcastChannel< T, Scheduler >* chan;
+};
+
+// Subscriber with its own cursor. A copy starts where the original is and sees the same messages from there
+template< class T, class Scheduler = ScheduleFunc >
+class BroadcastReceiver
+{
+  public:
+    BroadcastReceiver() = delete;
+
+    BroadcastReceiver( const BroadcastReceiver& other )
+        : chan( other.chan )
+        , cursor( chan->addReceiver( &other ) )
+    {
+    }
+
+    BroadcastReceiver( BroadcastReceiver&& other ) noexcept
+        : chan( std::exchange( other.chan, nullptr ) )
+        , cursor( other.cursor )
+    {
+    }
+
+    ~BroadcastReceiver()
+    {
+        if( chan )
+        {
+            chan->dropReceiver( cursor );
+        }
+    }
+
+    BroadcastReceiver& operator=( const BroadcastReceiver& ) = delete;
+    BroadcastReceiver& operator=( BroadcastReceiver&& ) = delete;
+
+    // The receiver has to outlive the returned awaitable
+    AwaitableBroadcastReceive< T, Scheduler > receive()
+    {
+        return AwaitableBroadcastReceive< T, Scheduler >( this );
+    }
+
+    // Never suspends, status is TryResult::Empty if there is nothing new
+    BroadcastResult< T > tryReceive()
+    {
+        return chan->tryReceive( *this );
+    }
+
+  private:
+    // Starts at the tail without from
+    BroadcastReceiver( BroadcastChannel< T, Scheduler >* theChan, const BroadcastReceiver* from )
+        : chan( theChan )
+        , cursor( chan->addReceiver( from ) )
+    {
+    }
+
+    friend BroadcastChannel< T, Scheduler >;
+    friend BroadcastSender< T, Scheduler >;
+    friend AwaitableBroadcastReceive< T, Scheduler >;
+
+    BroadcastChannel< T, Scheduler >* chan;
+    // Number of the next message to read, only touched under the channel's mutex
+    std::uint64_t cursor;
+};
+
+template< class T, class Scheduler = ScheduleFunc >
+std::tuple< BroadcastSender< T, Scheduler >, BroadcastReceiver< T, Scheduler > > makeBroadcastChannel(
+    std::size_t capacity = 1, LagPolicy policy = LagPolicy::Backpressure,
+    const std::type_identity_t< Scheduler >& scheduler = defaultScheduleFunc,
+    std::pmr::memory_resource* resource = std::pmr::new_delete_resource() )
+{
+    return BroadcastChannel< T, Scheduler >::open( resource, capacity, policy, scheduler );
+}
+
+} // namespace cochan
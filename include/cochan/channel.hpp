@@ -3,14 +3,23 @@
 #include <cstdint>
 #include <cstddef>
 #include <atomic>
-#include <queue>
 #include <mutex>
 #include <optional>
-#include <list>
 #include <coroutine>
 #include <utility>
+#include <tuple>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <vector>
 
 #include <cochan/utils.hpp>
+#include <cochan/mpmc_ring.hpp>
+#include <cochan/waiter_list.hpp>
+#include <cochan/scheduler.hpp>
+#include <cochan/stats.hpp>
+#include <cochan/trace.hpp>
 
 namespace cochan
 {
@@ -23,22 +32,116 @@ class ChannelClosedException: public std::exception
     }
 };
 
-using ScheduleFunc = std::function< void( std::coroutine_handle<> ) >;
-const ScheduleFunc defaultScheduleFunc = []( std::coroutine_handle<> handle ) {
-    handle.resume();
+// Outcome of the non-suspending trySend/tryReceive and of the timed and cancellable operations
+enum class TryResult
+{
+    Ok,
+    Full,
+    Empty,
+    Closed,
+    TimedOut,
+    Cancelled,
+    // Broadcast subscriber fell behind and missed messages, see broadcast.hpp
+    Lagged,
+};
+
+// value is set only when status is TryResult::Ok
+template< class T >
+struct ReceiveResult
+{
+    TryResult status;
+    std::optional< T > value;
 };
 
-template< typename T >
+template< std::movable T, class Storage = MpmcRing< T >, class Scheduler = ScheduleFunc, class Stats = NoStats >
+class Channel;
+
+template< class T, class Chan = Channel< T > >
 class Sender;
 
-template< typename T >
+template< class T, class Chan = Channel< T > >
 class Receiver;
 
+template< class T, class Chan = Channel< T > >
+class AwaitableSend;
+
+template< class T, class Chan = Channel< T > >
+class AwaitableReceive;
+
+template< class T, class Chan = Channel< T > >
+class AwaitableSendBatch;
+
+template< class T, class Chan, class... Args >
+class AwaitableEmplace;
+
+template< class T, class Chan = Channel< T > >
+class AwaitableReceiveBatch;
+
+template< class T, class Chan, class Trigger >
+class AwaitableInterruptibleSend;
+
+template< class T, class Chan, class Trigger >
+class AwaitableInterruptibleReceive;
+
+template< class Case >
+struct SelectCase;
+
+// Storage is the queue values travel through: lock-free MpmcRing by default, SpscRing for
+// makeSpscChannel, SegmentedQueue for makeUnboundedChannel, PriorityHeap for makePriorityChannel.
+// It has to provide tryPush( T& ) that moves from the value only on success, tryPop( std::optional< T >& ) and size().
+// Both may fail spuriously while a concurrent operation on the same cell is in flight. With capacity 0 both always fail
+// and every send rendezvous with a receive, handing the value over directly.
+// Storage constructible from ( capacity, std::pmr::memory_resource*, storageArgs... ) allocates from the channel's resource.
+// mutex is only taken to park or unpark a coroutine and for lifetime transitions, see DISCUSSION.md.
+// Scheduler is either ScheduleFunc or a SchedulerPolicy, see scheduler.hpp.
+// Stats is NoStats, ChannelStats or ContentionStats, see stats.hpp.
 // TODO: case for copy_constructible only
-template< std::movable T >
+template< std::movable T, class Storage, class Scheduler, class Stats >
 class Channel
 {
   public:
+    using SendWaiter = WaiterNode< T, typename Stats::Stamp >;
+    using ReceiveWaiter = WaiterNode< std::optional< T >, typename Stats::Stamp >;
+    using StatsPolicy = Stats;
+    using Mutex = typename Stats::Mutex;
+
+    // Senders transfer straight into the receiver they wake, see HandOffSchedulerPolicy
+    static constexpr bool handOff = HandOffSchedulerPolicy< Scheduler >;
+
+    // Owners of the channel, counted in 32-bit halves of one word per side: endpoints low, awaitables high
+    static constexpr std::uint64_t senderUnit = 1;
+    static constexpr std::uint64_t receiverUnit = 1;
+    static constexpr std::uint64_t awaitableSenderUnit = std::uint64_t( 1 ) << 32;
+    static constexpr std::uint64_t awaitableReceiverUnit = std::uint64_t( 1 ) << 32;
+
+    // Allocates the channel from resource and hands out its first endpoints. The channel destroys itself
+    // once all of them are gone. storageArgs are passed to Storage after capacity
+    template< class... StorageArgs >
+    static std::tuple< Sender< T, Channel >, Receiver< T, Channel > > open(
+        std::pmr::memory_resource* resource, std::size_t capacity, const Scheduler& scheduler, StorageArgs&&... storageArgs )
+    {
+        void* memory = resource->allocate( sizeof( Channel ), alignof( Channel ) );
+        Channel* chan;
+        try
+        {
+            chan = new( memory ) Channel( resource, capacity, scheduler, std::forward< StorageArgs >( storageArgs )... );
+        }
+        catch( ... )
+        {
+            resource->deallocate( memory, sizeof( Channel ), alignof( Channel ) );
+            throw;
+        }
+
+        return { Sender< T, Channel >{ chan }, Receiver< T, Channel >{ chan } };
+    }
+
+    template< class... StorageArgs >
+    static std::tuple< Sender< T, Channel >, Receiver< T, Channel > > open(
+        std::size_t capacity, const Scheduler& scheduler, StorageArgs&&... storageArgs )
+    {
+        return open( std::pmr::new_delete_resource(), capacity, scheduler, std::forward< StorageArgs >( storageArgs )... );
+    }
+
     ~Channel()
     {
         COCHAN_ASSERT( receiverWaiters.empty(), "Should be handled by last sendable object" );
@@ -47,7 +150,6 @@ class Channel
 
     std::size_t getSize() const
     {
-        const std::lock_guard< std::mutex > guard( mutex );
         return sendQueue.size();
     }
 
@@ -61,165 +163,924 @@ class Channel
         return closed;
     }
 
-    std::list< std::pair< std::optional< T >*, std::coroutine_handle<> > > collectReceiveWaiters()
+    void close()
+    {
+        closed = true;
+        trace( TraceKind::Close );
+    }
+
+    ChannelStatsSnapshot getStats() const
+        requires( Stats::enabled )
     {
-        if( receiverWaiters.empty() )
+        auto result = stats.snapshot();
+        if constexpr( std::is_same_v< Mutex, ProfiledMutex > )
         {
-            return {};
+            result.locks = mutex.snapshot();
         }
 
-        COCHAN_ASSERT( sendQueue.empty() && senderWaiters.empty(), "Bug or wrong assumption of that being impossible" );
-        const auto waitersCopy = receiverWaiters;
-        receiverWaiters.clear();
+        return result;
+    }
+
+    // Takes every parked receiver once the channel is closed, called under mutex. Plain waiters are detached in O(1)
+    // and get their std::nullopt from releaseClosed after mutex is released. Waiters with a WaitState may be
+    // unparked by their select, timeout or cancellation under mutex at any moment, so while any is parked the list
+    // is walked here to acquire each one: O(n) under mutex, but only for lists that mix in such waiters.
+    WaiterList< ReceiveWaiter > collectReceiveWaiters()
+    {
+        receiversParked.store( false, std::memory_order_relaxed );
+        return receiverWaiters.hasStates() ? acquireAll( receiverWaiters ) : receiverWaiters.splice();
+    }
 
-        return waitersCopy;
+    // Same for senders, whose values are just left behind
+    WaiterList< SendWaiter > collectSendWaiters()
+    {
+        sendersParked.store( false, std::memory_order_relaxed );
+        return senderWaiters.hasStates() ? acquireAll( senderWaiters ) : senderWaiters.splice();
     }
 
-    std::list< std::pair< T*, std::coroutine_handle<> > > collectSendWaiters()
+    template< class Node >
+    static WaiterList< Node > acquireAll( WaiterList< Node >& waiters )
     {
-        if( senderWaiters.empty() )
+        WaiterList< Node > released;
+        while( Node* waiter = waiters.pop_front() )
         {
-            return {};
-        }
+            if( !waiter->acquire() )
+            {
+                continue;
+            }
 
-        COCHAN_ASSERT( sendQueue.size() == capacity && receiverWaiters.empty(), "" )
-        const auto waitersCopy = senderWaiters;
-        senderWaiters.clear();
+            waiter->commit();
+            released.push_back( waiter );
+        }
 
-        return waitersCopy;
+        return released;
     }
 
-    bool handleSend( std::pair< T*, std::coroutine_handle<> > value )
+    // Rest of closing, outside mutex. Collected waiters are resumed by whoever releases them, i.e. not before
+    // scheduleAll, so nothing else touches their slots meanwhile
+    static void releaseClosed( WaiterList< ReceiveWaiter >& waiters )
     {
-        std::unique_lock< std::mutex > guard( mutex );
-        const auto currentSize = sendQueue.size();
+        for( ReceiveWaiter* waiter = waiters.front(); waiter; waiter = waiter->next )
+        {
+            *waiter->slot = std::nullopt;
+        }
+    }
 
-        COCHAN_ASSERT( currentSize <= capacity, "Queue got larger than capacity. bug" );
-        if( sendQueue.size() == capacity )
+    // Returns whether sender got parked. sender may carry a batch: remaining values laid out contiguously from slot.
+    // A sender with WaitState, see select.hpp, also returns false when it was completed through another waiter.
+    // With next the first receiver woken is not scheduled, its handle is stored there for the caller to resume.
+    bool handleSend( SendWaiter& sender, std::coroutine_handle<>* next = nullptr )
+    {
+        while( true )
         {
-            if( receivers == 0 && awaitableReceivers == 0 )
+            // One fence and at most one lock for the whole batch
+            const auto pushed = pushFrom( sender );
+            if( pushed == Transfer::Lost )
             {
                 return false;
             }
 
-            senderWaiters.push_back( value );
-            return true;
+            if( pushed == Transfer::Done )
+            {
+                releaseReceivers( next );
+            }
+
+            if( sender.remaining == 0 )
+            {
+                return false;
+            }
+
+            auto guard = lockAt( mutex, LockSite::HandleSend );
+
+            // Rendezvous: values go straight into parked receivers' slots, never touching the queue
+            if( receiverWaiters.front_other( sender.state ) )
+            {
+                WaiterList< ReceiveWaiter > released;
+                bool lost = false;
+                while( sender.remaining != 0 )
+                {
+                    ReceiveWaiter* receiver = receiverWaiters.front_other( sender.state );
+                    if( !receiver )
+                    {
+                        break;
+                    }
+
+                    const auto acquired = acquirePair( sender, *receiver );
+                    if( acquired == Transfer::Failed )
+                    {
+                        // Completed through another channel, just drop it
+                        receiverWaiters.remove( receiver );
+                        continue;
+                    }
+
+                    if( acquired == Transfer::Lost )
+                    {
+                        lost = true;
+                        break;
+                    }
+
+                    *receiver->slot = takeNext( sender );
+                    receiver->commit();
+                    sender.commit();
+
+                    receiverWaiters.remove( receiver );
+                    released.push_back( receiver );
+                }
+
+                refreshParked();
+
+                // Prevent double-locks
+                guard.unlock();
+
+                scheduleReleased( released, next );
+                if( lost )
+                {
+                    return false;
+                }
+
+                // Whatever is left goes through the queue again. We can't park with woken receivers
+                // still to be scheduled: once parked, we may be resumed and the channel destroyed any moment.
+                continue;
+            }
+
+            if( !hasReceivables() )
+            {
+                if( sender.acquire() )
+                {
+                    sender.commit();
+                }
+
+                return false;
+            }
+
+            // Announce parking before re-checking the queue. Pairs with the fence in releaseSenders:
+            // either we see the slot a receiver freed, or that receiver sees us and hands our value over.
+            // No receiver is parked now, so whatever we push here is seen by the next one that tries.
+            sendersParked.store( true, std::memory_order_relaxed );
+            std::atomic_thread_fence( std::memory_order_seq_cst );
+
+            if( pushFrom( sender ) != Transfer::Lost && sender.remaining != 0 )
+            {
+                senderWaiters.push_back( &sender );
+                stats.senderParked( sender );
+                trace( TraceKind::SenderPark, sender.handle );
+                return true;
+            }
+
+            refreshParked();
+            return false;
         }
+    }
 
-        // If not empty there are no receivers so just handleSend
-        if( !sendQueue.empty() )
+    // Returns whether receiver got parked, same as handleSend
+    bool handleReceive( ReceiveWaiter& receiver )
+    {
+        const auto popped = popInto( receiver );
+        if( popped == Transfer::Done )
         {
-            COCHAN_ASSERT( receiverWaiters.empty(), "Bug or wrong assumption of that being impossible" );
-            sendQueue.emplace( std::move( *value.first ) );
+            releaseSenders();
             return false;
         }
 
-        // If there's receiver just propagate value in its slot
-        if( !receiverWaiters.empty() )
+        if( popped == Transfer::Lost )
         {
-            const auto [ result, receiverHandle ] = receiverWaiters.front();
-            receiverWaiters.pop_front();
-            *result = std::move( *value.first );
+            return false;
+        }
+
+        auto guard = lockAt( mutex, LockSite::HandleReceive );
+
+        // Same handshake as in handleSend, pairs with the fence in releaseReceivers
+        receiversParked.store( true, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+
+        const auto retried = popInto( receiver );
+        if( retried != Transfer::Failed )
+        {
+            refreshParked();
+            guard.unlock();
+
+            if( retried == Transfer::Done )
+            {
+                releaseSenders();
+            }
+
+            return false;
+        }
+
+        // Same rendezvous as in handleSend, take value straight from parked sender
+        while( SendWaiter* sender = senderWaiters.front_other( receiver.state ) )
+        {
+            const auto acquired = acquirePair( receiver, *sender );
+            if( acquired == Transfer::Failed )
+            {
+                senderWaiters.remove( sender );
+                continue;
+            }
+
+            if( acquired == Transfer::Lost )
+            {
+                refreshParked();
+                return false;
+            }
+
+            *receiver.slot = takeNext( *sender );
+            receiver.commit();
+
+            // Batch sender stays parked until all of its values are taken
+            if( sender->remaining != 0 )
+            {
+                refreshParked();
+                return false;
+            }
+
+            sender->commit();
+            senderWaiters.remove( sender );
+            refreshParked();
 
             // Prevent double-locks
             guard.unlock();
 
-            scheduleFunc( receiverHandle );
+            wake( *sender );
             return false;
         }
 
-        sendQueue.emplace( std::move( *value.first ) );
-        return false;
+        // No one will send anything already
+        if( sendsExhausted() )
+        {
+            if( receiver.acquire() )
+            {
+                *receiver.slot = std::nullopt;
+                receiver.commit();
+            }
+
+            refreshParked();
+            return false;
+        }
+
+        // Nothing to receive - park
+        receiverWaiters.push_back( &receiver );
+        stats.receiverParked( receiver );
+        trace( TraceKind::ReceiverPark, receiver.handle );
+        return true;
+    }
+
+    // Takes a parked waiter, which is not going to be completed any more, out of the waiter list
+    template< class Node >
+    void unpark( Node& waiter )
+    {
+        const auto guard = lockAt( mutex, LockSite::Unpark );
+        auto& waiters = waitersOf( waiter );
+        if( waiters.contains( &waiter ) )
+        {
+            waiters.remove( &waiter );
+            refreshParked();
+        }
+    }
+
+    // Moves up to maxCount queued values into out without parking. One fence and at most one lock for all of them
+    std::size_t receiveAvailable( std::vector< T >& out, std::size_t maxCount )
+    {
+        std::optional< T > value;
+        std::size_t count = 0;
+        while( count < maxCount && sendQueue.tryPop( value ) )
+        {
+            out.push_back( std::move( *value ) );
+            count++;
+        }
+
+        if( count != 0 )
+        {
+            stats.received( count );
+            releaseSenders();
+        }
+
+        return count;
+    }
+
+    // Lock-free part of handleSend, used by await_ready to skip suspending when there is room
+    bool trySendReady( T& value )
+    {
+        if( !sendQueue.tryPush( value ) )
+        {
+            return false;
+        }
+
+        stats.sent();
+        stats.queued( sendQueue );
+        releaseReceivers();
+        return true;
+    }
+
+    // Lock-free part of handleReceive
+    bool tryReceiveReady( std::optional< T >& result )
+    {
+        if( !sendQueue.tryPop( result ) )
+        {
+            return false;
+        }
+
+        stats.received();
+        releaseSenders();
+        return true;
     }
 
-    bool handleReceive( std::pair< std::optional< T >*, std::coroutine_handle<> > receiver )
+    // Values of Sender::emplace are constructed in the channel only when that can't throw and the queue can
+    // construct in place, otherwise they are built up front and moved in
+    template< class... Args >
+    static constexpr bool emplacesInPlace = std::is_nothrow_constructible_v< T, Args&&... > && requires( Storage& queue, Args&&... args ) {
+        queue.tryEmplace( std::forward< Args >( args )... );
+    };
+
+    // trySendReady constructing the value from args straight into a parked receiver's slot or a free queue cell.
+    // args are left untouched when it returns false. A receiver only parks on an empty queue,
+    // so while one is parked the value goes to it rather than to the queue it would be moved out of.
+    template< class... Args >
+    bool tryEmplaceReady( Args&&... args )
     {
-        std::unique_lock< std::mutex > guard( mutex );
-        if( sendQueue.empty() )
+        if( receiversParked.load( std::memory_order_relaxed ) )
         {
-            // No one will send anything already
-            if( ( senders == 0 || closed ) && awaitableSenders == 0 )
+            auto guard = lockAt( mutex, LockSite::TrySend );
+            if( emplaceParked( guard, std::forward< Args >( args )... ) )
+            {
+                return true;
+            }
+        }
+
+        if constexpr( emplacesInPlace< Args... > )
+        {
+            if( !sendQueue.tryEmplace( std::forward< Args >( args )... ) )
+            {
+                return false;
+            }
+        }
+        else
+        {
+            static_assert( sizeof...( Args ) == 1, "Values that can't be emplaced are built by the caller" );
+            if( !sendQueue.tryPush( args... ) )
             {
-                *receiver.first = std::nullopt;
                 return false;
             }
+        }
 
-            // Nothing to receive - park
-            receiverWaiters.push_back( receiver );
-            return true;
+        stats.sent();
+        stats.queued( sendQueue );
+        releaseReceivers();
+        return true;
+    }
+
+    // handleSend that never parks. value is moved from only on TryResult::Ok
+    TryResult trySend( T& value )
+    {
+        if( closed )
+        {
+            return TryResult::Closed;
+        }
+
+        if( trySendReady( value ) )
+        {
+            return TryResult::Ok;
+        }
+
+        auto guard = lockAt( mutex, LockSite::TrySend );
+        if( emplaceParked( guard, std::move( value ) ) )
+        {
+            return TryResult::Ok;
         }
 
-        COCHAN_ASSERT( receiverWaiters.empty(), "If element's in queue receiverWaiters shall be empty" )
+        if( closed || !hasReceivables() )
+        {
+            return TryResult::Closed;
+        }
 
-        T value = std::move( sendQueue.front() );
-        sendQueue.pop();
+        return TryResult::Full;
+    }
 
-        // Was full and have sender waiters
-        if( sendQueue.size() + 1 == capacity && !senderWaiters.empty() )
+    // handleReceive that never parks
+    TryResult tryReceive( std::optional< T >& result )
+    {
+        if( tryReceiveReady( result ) )
         {
-            const auto [ senderValue, senderHandle ] = senderWaiters.front();
+            return TryResult::Ok;
+        }
+
+        auto guard = lockAt( mutex, LockSite::TryReceive );
+        while( SendWaiter* sender = senderWaiters.front() )
+        {
+            if( !sender->acquire() )
+            {
+                senderWaiters.pop_front();
+                continue;
+            }
+
+            result = takeNext( *sender );
+            if( sender->remaining != 0 )
+            {
+                return TryResult::Ok;
+            }
+
+            sender->commit();
             senderWaiters.pop_front();
-            sendQueue.emplace( std::move( *senderValue ) );
+            refreshParked();
 
             // Prevent double-locks
             guard.unlock();
 
-            scheduleFunc( senderHandle );
+            wake( *sender );
+            return TryResult::Ok;
         }
 
-        *receiver.first = std::move( value );
-        return false;
+        refreshParked();
+        if( sendsExhausted() )
+        {
+            return TryResult::Closed;
+        }
+
+        return TryResult::Empty;
+    }
+
+    // Called by every new owner. It is always copied from an existing one, so the count can't be coming back from 0
+    void retainSendable( std::uint64_t unit )
+    {
+        retain( sendables, unit );
+    }
+
+    void retainReceivable( std::uint64_t unit )
+    {
+        retain( receivables, unit );
+    }
+
+    // Called by every sendable on destruction with its unit. Once none are left the channel is closed and parked
+    // receivers get std::nullopt, or the channel is deleted if no receivables are left either.
+    // Only the last sendable takes mutex, the rest just decrement.
+    void dropSendable( std::uint64_t unit )
+    {
+        if( releaseShared( sendables, unit ) )
+        {
+            return;
+        }
+
+        auto guard = lockAt( mutex, unit == senderUnit ? LockSite::DropSender : LockSite::DropAwaitableSender );
+        sendables.fetch_sub( unit, std::memory_order_acq_rel );
+        if( receivables.load( std::memory_order_acquire ) == 0 )
+        {
+            guard.unlock();
+            destroy();
+            return;
+        }
+
+        auto waiters = collectReceiveWaiters();
+        closed = true;
+        stats.closeReleased( waiters );
+        trace( TraceKind::Close );
+        traceWoken( waiters );
+
+        // Woken receivers may destroy the channel, don't touch it after the first wake
+        Scheduler schedule = scheduler;
+        guard.unlock();
+
+        releaseClosed( waiters );
+        scheduleAll( schedule, waiters );
+    }
+
+    // Same for receivables. Parked senders are woken up and their values dropped
+    void dropReceivable( std::uint64_t unit )
+    {
+        if( releaseShared( receivables, unit ) )
+        {
+            return;
+        }
+
+        auto guard = lockAt( mutex, unit == receiverUnit ? LockSite::DropReceiver : LockSite::DropAwaitableReceiver );
+        receivables.fetch_sub( unit, std::memory_order_acq_rel );
+        if( sendables.load( std::memory_order_acquire ) == 0 )
+        {
+            guard.unlock();
+            destroy();
+            return;
+        }
+
+        auto waiters = collectSendWaiters();
+        closed = true;
+        stats.closeReleased( waiters );
+        trace( TraceKind::Close );
+        traceWoken( waiters );
+
+        // Woken senders may destroy the channel, don't touch it after the first wake
+        Scheduler schedule = scheduler;
+        guard.unlock();
+
+        scheduleAll( schedule, waiters );
     }
 
   private:
-    explicit Channel( std::size_t theCapacity, const ScheduleFunc& theScheduleFunc )
-        : capacity( theCapacity )
-        , scheduleFunc( theScheduleFunc )
+    template< class... StorageArgs >
+    explicit Channel( std::pmr::memory_resource* theResource, std::size_t theCapacity, const Scheduler& theScheduler, StorageArgs&&... storageArgs )
+        : resource( theResource )
+        , scheduler( theScheduler )
+        , capacity( theCapacity )
+        , sendQueue( makeStorage( theResource, theCapacity, std::forward< StorageArgs >( storageArgs )... ) )
     {
-        COCHAN_ASSERT_FORMAT( theCapacity != 0, "Channel capacity must be greater than 0" );
     }
 
     Channel( const Channel& ) = delete;
     Channel( Channel&& ) = delete;
 
-    mutable std::mutex mutex;
+    // Storage is neither copyable nor movable, it is constructed in place through guaranteed copy elision
+    template< class... StorageArgs >
+    static Storage makeStorage( std::pmr::memory_resource* resource, std::size_t capacity, StorageArgs&&... storageArgs )
+    {
+        if constexpr( std::is_constructible_v< Storage, std::size_t, std::pmr::memory_resource*, StorageArgs&&... > )
+        {
+            return Storage( capacity, resource, std::forward< StorageArgs >( storageArgs )... );
+        }
+        else
+        {
+            return Storage( capacity, std::forward< StorageArgs >( storageArgs )... );
+        }
+    }
+
+    static constexpr std::uint64_t fieldMask = 0xffffffff;
+
+    static std::uint64_t count( const std::atomic_uint64_t& side, std::uint64_t unit )
+    {
+        return side.load( std::memory_order_acquire ) / unit & fieldMask;
+    }
+
+    // Checked before adding, so a full half never carries into its neighbour
+    static void retain( std::atomic_uint64_t& side, std::uint64_t unit )
+    {
+        auto state = side.load( std::memory_order_relaxed );
+        do
+        {
+            if( ( state / unit & fieldMask ) == fieldMask )
+            {
+                throw std::overflow_error( "Too many channel owners of one kind" );
+            }
+        } while( !side.compare_exchange_weak( state, state + unit, std::memory_order_relaxed ) );
+    }
+
+    // Drops unit unless it is the last one of its side, whose drop has to close or destroy the channel under mutex.
+    // Owners are only ever copied from owners of the same side, so once alone the caller stays alone.
+    static bool releaseShared( std::atomic_uint64_t& side, std::uint64_t unit )
+    {
+        auto state = side.load( std::memory_order_relaxed );
+        while( state != unit )
+        {
+            if( side.compare_exchange_weak( state, state - unit, std::memory_order_acq_rel, std::memory_order_relaxed ) )
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool hasReceivables() const
+    {
+        return receivables.load( std::memory_order_acquire ) != 0;
+    }
+
+    // No one will send anything already: awaitables in flight still may, even after close()
+    bool sendsExhausted() const
+    {
+        return ( count( sendables, senderUnit ) == 0 || closed ) && count( sendables, awaitableSenderUnit ) == 0;
+    }
+
+    void destroy()
+    {
+        std::pmr::memory_resource* memory = resource;
+        std::destroy_at( this );
+        memory->deallocate( this, sizeof( Channel ), alignof( Channel ) );
+    }
+
+    // Outcome of moving values between a waiter and the queue or another waiter. Lost means the waiter
+    // is already completed through another channel, only possible for waiters with WaitState.
+    enum class Transfer
+    {
+        Done,
+        Failed,
+        Lost,
+    };
+
+    bool pushNext( SendWaiter& sender )
+    {
+        if( sender.remaining == 0 || !sendQueue.tryPush( *sender.slot ) )
+        {
+            return false;
+        }
+
+        stats.sent();
+        stats.queued( sendQueue );
+        sender.slot++;
+        sender.remaining--;
+        return true;
+    }
+
+    // Pushes as many of sender's values as fit. Done if at least one was pushed
+    Transfer pushFrom( SendWaiter& sender )
+    {
+        if( !sender.acquire() )
+        {
+            return Transfer::Lost;
+        }
+
+        bool pushed = false;
+        while( pushNext( sender ) )
+        {
+            pushed = true;
+        }
+
+        if( sender.remaining == 0 )
+        {
+            sender.commit();
+        }
+        else
+        {
+            sender.abort();
+        }
+
+        return pushed ? Transfer::Done : Transfer::Failed;
+    }
+
+    Transfer popInto( ReceiveWaiter& receiver )
+    {
+        if( !receiver.acquire() )
+        {
+            return Transfer::Lost;
+        }
+
+        if( !sendQueue.tryPop( *receiver.slot ) )
+        {
+            receiver.abort();
+            return Transfer::Failed;
+        }
 
-    template< typename U >
-    friend class Sender;
+        stats.received();
+        receiver.commit();
+        return Transfer::Done;
+    }
 
-    template< class U >
-    friend class AwaitableSend;
+    // Acquires both sides of a hand-off. Lost if own is completed elsewhere, Failed if other is.
+    // Two waiters with WaitState are acquired in address order, so two selects meeting on a channel can't deadlock.
+    template< class Own, class Other >
+    static Transfer acquirePair( Own& own, Other& other )
+    {
+        if( !own.state || !other.state || std::less<>{}( own.state, other.state ) )
+        {
+            if( !own.acquire() )
+            {
+                return Transfer::Lost;
+            }
 
-    template< typename U >
-    friend class Receiver;
+            if( !other.acquire() )
+            {
+                own.abort();
+                return Transfer::Failed;
+            }
 
-    template< class U >
-    friend class AwaitableReceive;
+            return Transfer::Done;
+        }
 
-    template< class U >
-    friend std::tuple< Sender< U >, Receiver< U > > makeChannel( std::size_t capacity, const ScheduleFunc& );
+        if( !other.acquire() )
+        {
+            return Transfer::Failed;
+        }
 
-    ScheduleFunc scheduleFunc;
+        if( !own.acquire() )
+        {
+            other.abort();
+            return Transfer::Lost;
+        }
+
+        return Transfer::Done;
+    }
+
+    // Hands one value straight from sender to a receiver
+    T&& takeNext( SendWaiter& sender )
+    {
+        stats.sent();
+        stats.received();
+        sender.remaining--;
+        return std::move( *sender.slot++ );
+    }
+
+    template< class Node >
+    void wake( Node& waiter )
+    {
+        stats.woken( waiter );
+        trace( TraceKind::Wake, waiter.handle );
+        const auto handle = waiter.handle;
+        if( waiter.release() )
+        {
+            scheduleOn( scheduler, handle );
+        }
+    }
+
+    // Keeps the first waiter that has to be resumed for symmetric transfer if next is given and still empty
+    void scheduleReleased( WaiterList< ReceiveWaiter >& released, std::coroutine_handle<>* next )
+    {
+        stats.woken( released );
+        traceWoken( released );
+        while( next && !*next && !released.empty() )
+        {
+            ReceiveWaiter* waiter = released.pop_front();
+            const auto handle = waiter->handle;
+            if( waiter->release() )
+            {
+                *next = handle;
+            }
+        }
+
+        scheduleAll( scheduler, released );
+    }
+
+    // Constructs the value into the first parked receiver that can still take it and wakes it up, unlocking guard.
+    // Otherwise returns false with guard still held and args untouched
+    template< class... Args >
+    bool emplaceParked( std::unique_lock< Mutex >& guard, Args&&... args )
+    {
+        while( ReceiveWaiter* receiver = receiverWaiters.pop_front() )
+        {
+            if( !receiver->acquire() )
+            {
+                continue;
+            }
+
+            receiver->slot->emplace( std::forward< Args >( args )... );
+            receiver->commit();
+            refreshParked();
+            stats.sent();
+            stats.received();
+
+            // Prevent double-locks
+            guard.unlock();
+
+            wake( *receiver );
+            return true;
+        }
+
+        refreshParked();
+        return false;
+    }
+
+    // Compiled out unless COCHAN_TRACE is defined, see trace.hpp
+    void trace( TraceKind kind, std::coroutine_handle<> handle = {} ) const
+    {
+        if constexpr( traceEnabled )
+        {
+            traceEvent( kind, this, handle.address(), sendQueue.size() );
+        }
+    }
+
+    // Called before the waiters are scheduled, they may be gone right after
+    template< class Node >
+    void traceWoken( const WaiterList< Node >& waiters ) const
+    {
+        if constexpr( traceEnabled )
+        {
+            for( const Node* waiter = waiters.front(); waiter; waiter = waiter->next )
+            {
+                trace( TraceKind::Wake, waiter->handle );
+            }
+        }
+    }
+
+    WaiterList< SendWaiter >& waitersOf( SendWaiter& )
+    {
+        return senderWaiters;
+    }
+
+    WaiterList< ReceiveWaiter >& waitersOf( ReceiveWaiter& )
+    {
+        return receiverWaiters;
+    }
+
+    // Called under mutex whenever waiter lists change
+    void refreshParked()
+    {
+        sendersParked.store( !senderWaiters.empty(), std::memory_order_relaxed );
+        receiversParked.store( !receiverWaiters.empty(), std::memory_order_relaxed );
+    }
+
+    // Called after publishing an element. Drains the queue into parked receivers, so that the queue is never
+    // left non-empty while someone is parked on it, even if a concurrent tryPop failed spuriously.
+    void releaseReceivers( std::coroutine_handle<>* next = nullptr )
+    {
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+        if( !receiversParked.load( std::memory_order_relaxed ) )
+        {
+            return;
+        }
+
+        WaiterList< ReceiveWaiter > released;
+        auto guard = lockAt( mutex, LockSite::ReleaseReceivers );
+        while( ReceiveWaiter* receiver = receiverWaiters.front() )
+        {
+            const auto popped = popInto( *receiver );
+            if( popped == Transfer::Failed )
+            {
+                break;
+            }
+
+            receiverWaiters.pop_front();
+            if( popped == Transfer::Done )
+            {
+                released.push_back( receiver );
+            }
+        }
+
+        receiversParked.store( !receiverWaiters.empty(), std::memory_order_relaxed );
+
+        // Prevent double-locks
+        guard.unlock();
+
+        scheduleReleased( released, next );
+    }
+
+    // Called after freeing a slot. Moves parked senders' values into the queue while there is room
+    void releaseSenders()
+    {
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+        if( !sendersParked.load( std::memory_order_relaxed ) )
+        {
+            return;
+        }
+
+        WaiterList< SendWaiter > released;
+        auto guard = lockAt( mutex, LockSite::ReleaseSenders );
+        while( SendWaiter* sender = senderWaiters.front() )
+        {
+            if( pushFrom( *sender ) == Transfer::Lost )
+            {
+                senderWaiters.pop_front();
+                continue;
+            }
+
+            if( sender->remaining != 0 )
+            {
+                break;
+            }
+
+            released.push_back( senderWaiters.pop_front() );
+        }
+
+        sendersParked.store( !senderWaiters.empty(), std::memory_order_relaxed );
+
+        // Prevent double-locks
+        guard.unlock();
+
+        stats.woken( released );
+        traceWoken( released );
+        scheduleAll( scheduler, released );
+    }
+
+    mutable Mutex mutex;
+
+    friend Sender< T, Channel >;
+    friend AwaitableSend< T, Channel >;
+    friend Receiver< T, Channel >;
+    friend AwaitableReceive< T, Channel >;
+    friend AwaitableSendBatch< T, Channel >;
+    friend AwaitableReceiveBatch< T, Channel >;
+    template< class U, class C, class... Args >
+    friend class AwaitableEmplace;
+    template< class U, class C, class Trigger >
+    friend class AwaitableInterruptibleSend;
+    template< class U, class C, class Trigger >
+    friend class AwaitableInterruptibleReceive;
+
+    std::pmr::memory_resource* resource;
+    [[no_unique_address]] Scheduler scheduler;
 
     std::size_t capacity;
-    std::queue< T > sendQueue; // TODO: change queue type + circular buffer
+    Storage sendQueue;
     std::atomic_bool closed = false;
 
-    std::atomic_uint32_t senders = 0;
-    std::atomic_uint32_t receivers = 0;
-    std::atomic_uint32_t awaitableSenders = 0;
-    std::atomic_uint32_t awaitableReceivers = 0;
-
     // TODO: rename parkedSender
-    std::list< std::pair< T*, std::coroutine_handle<> > > senderWaiters;
-    std::list< std::pair< std::optional< T >*, std::coroutine_handle<> > > receiverWaiters;
+    WaiterList< SendWaiter > senderWaiters;
+    WaiterList< ReceiveWaiter > receiverWaiters;
+
+    // Senders and their awaitables, receivers and theirs. Written by every copy and drop from any thread,
+    // so each side gets a cache line of its own
+    alignas( cacheLineSize ) std::atomic_uint64_t sendables = 0;
+    alignas( cacheLineSize ) std::atomic_uint64_t receivables = 0;
+
+    // Lock-free hints for the fast path that someone may be parked. Only written under mutex
+    alignas( cacheLineSize ) std::atomic_bool sendersParked = false;
+    std::atomic_bool receiversParked = false;
+
+    [[no_unique_address]] Stats stats;
 };
 
-template< class T >
-std::tuple< Sender< T >, Receiver< T > > makeChannel( std::size_t capacity = 1, const ScheduleFunc& schedule = defaultScheduleFunc )
+// Pass a SchedulerPolicy explicitly, e.g. makeChannel< T, InlineScheduler >(), to have wakeups call it directly.
+// The channel and its ring are allocated from resource, e.g. blockPool() for channels created per request.
+// makeChannel< T, ScheduleFunc, ChannelStats >() counts traffic, see stats.hpp
+template< class T, class Scheduler = ScheduleFunc, class Stats = NoStats >
+std::tuple< Sender< T, Channel< T, MpmcRing< T >, Scheduler, Stats > >, Receiver< T, Channel< T, MpmcRing< T >, Scheduler, Stats > > > makeChannel(
+    std::size_t capacity = 1, const std::type_identity_t< Scheduler >& scheduler = defaultScheduleFunc,
+    std::pmr::memory_resource* resource = std::pmr::new_delete_resource() )
 {
-    auto chan = new Channel< T >( capacity, schedule );
-    return { Sender{ chan }, Receiver{ chan } };
+    return Channel< T, MpmcRing< T >, Scheduler, Stats >::open( resource, capacity, scheduler );
 }
 
 } // namespace cochan
\ No newline at end of file
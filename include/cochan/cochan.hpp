@@ -1,3 +1,17 @@
+#include <cochan/allocator_resource.hpp>
+#include <cochan/block_pool.hpp>
+#include <cochan/broadcast.hpp>
 #include <cochan/channel.hpp>
 #include <cochan/receiver.hpp>
-#include <cochan/sender.hpp>
\ No newline at end of file
+#include <cochan/sender.hpp>
+#include <cochan/select.hpp>
+#include <cochan/spsc_channel.hpp>
+#include <cochan/interrupt.hpp>
+#include <cochan/oneshot.hpp>
+#include <cochan/priority_channel.hpp>
+#include <cochan/profiled_mutex.hpp>
+#include <cochan/stats.hpp>
+#include <cochan/timer.hpp>
+#include <cochan/trace.hpp>
+#include <cochan/unbounded_channel.hpp>
+#include <cochan/watch.hpp>
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <stop_token>
+
+#include <cochan/channel.hpp>
+#include <cochan/timer.hpp>
+
+namespace cochan
+{
+
+// Triggers complete a parked AwaitableInterruptibleSend/Receive from the outside. arm is called once the waiter
+// is parked and may call fire( context ) right away or later from any thread. Once disarm returns fire is neither
+// running nor going to run, unless disarm is called from fire itself.
+// expired() is checked before touching the channel at all.
+
+// Fires at deadline, resumes with TryResult::TimedOut
+class TimerTrigger
+{
+  public:
+    static constexpr TryResult status = TryResult::TimedOut;
+
+    TimerTrigger( TimerSource& theTimer, TimerSource::Clock::time_point theDeadline )
+        : timer( &theTimer )
+        , deadline( theDeadline )
+    {
+    }
+
+    // Values that are ready are taken even if the deadline has already passed
+    bool expired() const
+    {
+        return false;
+    }
+
+    void arm( void ( *fire )( void* ), void* context )
+    {
+        id = timer->add( deadline, fire, context );
+    }
+
+    void disarm()
+    {
+        if( id != 0 )
+        {
+            timer->cancel( id );
+        }
+    }
+
+  private:
+    TimerSource* timer;
+    TimerSource::Clock::time_point deadline;
+    std::uint64_t id = 0;
+};
+
+// Fires when stop is requested on token, resumes with TryResult::Cancelled
+class StopTrigger
+{
+  public:
+    static constexpr TryResult status = TryResult::Cancelled;
+
+    explicit StopTrigger( std::stop_token theToken )
+        : token( std::move( theToken ) )
+    {
+    }
+
+    // Only ever moved before being armed
+    StopTrigger( StopTrigger&& other ) noexcept
+        : token( std::move( other.token ) )
+    {
+    }
+
+    bool expired() const
+    {
+        return token.stop_requested();
+    }
+
+    // Fires inline if stop has been requested in the meantime
+    void arm( void ( *fire )( void* ), void* context )
+    {
+        callback.emplace( token, Fire{ fire, context } );
+    }
+
+    // std::stop_callback waits for a callback running on another thread
+    void disarm()
+    {
+        callback.reset();
+    }
+
+  private:
+    struct Fire
+    {
+        void operator()() const
+        {
+            fire( context );
+        }
+
+        void ( *fire )( void* );
+        void* context;
+    };
+
+    std::stop_token token;
+    std::optional< std::stop_callback< Fire > > callback;
+};
+
+} // namespace cochan
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <concepts>
+#include <utility>
+
+#include <cochan/utils.hpp>
+
+namespace cochan
+{
+
+// Bounded multi-producer/multi-consumer ring in the style of Dmitry Vyukov's queue.
+// Every cell carries a sequence number telling whether it is ready to be written (sequence == 2 * position)
+// or read (sequence == 2 * position + 1) for the lap of the given position. Doubling keeps the two states
+// apart even for capacity 1, where the original position / position + 1 encoding would collide.
+// Producers and consumers only contend on their own position counter.
+// tryPush may fail spuriously while a consumer is still moving out of the cell, and tryPop while a
+// producer is still constructing into it. Channel tolerates that, see DISCUSSION.md.
+template< std::movable T >
+class MpmcRing
+{
+  public:
+    explicit MpmcRing( std::size_t theCapacity, std::pmr::memory_resource* theResource = std::pmr::new_delete_resource() )
+        : capacity( theCapacity )
+        , mask( theCapacity - 1 )
+        , powerOfTwo( theCapacity != 0 && ( theCapacity & ( theCapacity - 1 ) ) == 0 )
+        , allocator( theResource )
+        , cells( theCapacity != 0 ? allocator.allocate( theCapacity ) : nullptr )
+    {
+        for( std::size_t i = 0; i < capacity; i++ )
+        {
+            std::construct_at( cells + i );
+            cells[ i ].sequence.store( 2 * i, std::memory_order_relaxed );
+        }
+    }
+
+    MpmcRing( const MpmcRing& ) = delete;
+    MpmcRing& operator=( const MpmcRing& ) = delete;
+
+    ~MpmcRing()
+    {
+        std::optional< T > drained;
+        while( tryPop( drained ) )
+        {
+        }
+
+        if( cells )
+        {
+            std::destroy_n( cells, capacity );
+            allocator.deallocate( cells, capacity );
+        }
+    }
+
+    // value is moved from only on success
+    bool tryPush( T& value )
+    {
+        return tryEmplace( std::move( value ) );
+    }
+
+    // Constructs in the cell once it is reserved, args are untouched on failure. A throwing constructor
+    // would leave the cell reserved forever, so Channel only emplaces nothrow-constructible values
+    template< class... Args >
+    bool tryEmplace( Args&&... args )
+    {
+        if( capacity == 0 )
+        {
+            return false;
+        }
+
+        Cell* cell;
+        auto position = enqueuePosition.load( std::memory_order_relaxed );
+        while( true )
+        {
+            cell = &cells[ index( position ) ];
+            const auto sequence = cell->sequence.load( std::memory_order_acquire );
+            const auto diff = static_cast< std::intptr_t >( sequence ) - static_cast< std::intptr_t >( 2 * position );
+            if( diff == 0 )
+            {
+                if( enqueuePosition.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) )
+                {
+                    break;
+                }
+            }
+            else if( diff < 0 )
+            {
+                return false;
+            }
+            else
+            {
+                position = enqueuePosition.load( std::memory_order_relaxed );
+            }
+        }
+
+        std::construct_at( cell->value(), std::forward< Args >( args )... );
+        cell->sequence.store( 2 * position + 1, std::memory_order_release );
+        return true;
+    }
+
+    bool tryPop( std::optional< T >& result )
+    {
+        if( capacity == 0 )
+        {
+            return false;
+        }
+
+        Cell* cell;
+        auto position = dequeuePosition.load( std::memory_order_relaxed );
+        while( true )
+        {
+            cell = &cells[ index( position ) ];
+            const auto sequence = cell->sequence.load( std::memory_order_acquire );
+            const auto diff = static_cast< std::intptr_t >( sequence ) - static_cast< std::intptr_t >( 2 * position + 1 );
+            if( diff == 0 )
+            {
+                if( dequeuePosition.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) )
+                {
+                    break;
+                }
+            }
+            else if( diff < 0 )
+            {
+                return false;
+            }
+            else
+            {
+                position = dequeuePosition.load( std::memory_order_relaxed );
+            }
+        }
+
+        result = std::move( *cell->value() );
+        std::destroy_at( cell->value() );
+        cell->sequence.store( 2 * ( position + capacity ), std::memory_order_release );
+        return true;
+    }
+
+    // Only a snapshot when operations are in flight
+    std::size_t size() const
+    {
+        const auto consumed = dequeuePosition.load( std::memory_order_acquire );
+        return enqueuePosition.load( std::memory_order_acquire ) - consumed;
+    }
+
+  private:
+    struct Cell
+    {
+        T* value()
+        {
+            return reinterpret_cast< T* >( &storage );
+        }
+
+        std::atomic_size_t sequence;
+        alignas( T ) std::byte storage[ sizeof( T ) ];
+    };
+
+    // Positions grow monotonically. With a non power of two capacity the modulo mapping would break on
+    // size_t wrap-around, which is not reachable in practice on 64-bit platforms.
+    std::size_t index( std::size_t position ) const
+    {
+        return powerOfTwo ? position & mask : position % capacity;
+    }
+
+    const std::size_t capacity;
+    const std::size_t mask;
+    const bool powerOfTwo;
+    std::pmr::polymorphic_allocator< Cell > allocator;
+    Cell* const cells;
+
+    alignas( cacheLineSize ) std::atomic_size_t enqueuePosition = 0;
+    alignas( cacheLineSize ) std::atomic_size_t dequeuePosition = 0;
+};
+
+} // namespace cochan
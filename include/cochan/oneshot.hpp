@@ -0,0 +1,311 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <atomic>
+#include <coroutine>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+
+#include <cochan/utils.hpp>
+#include <cochan/scheduler.hpp>
+#include <cochan/channel.hpp>
+
+namespace cochan
+{
+
+template< class T, class Scheduler >
+class OneshotSender;
+
+template< class T, class Scheduler >
+class OneshotReceiver;
+
+// Control block of a oneshot channel: one slot for the value and a single state word. Every transition is a
+// fetch_or on state, whichever side sets its Gone bit second destroys the block. No mutex, no waiter list:
+// the only coroutine that can ever park is the receiver, its handle is published by the Parked bit.
+template< std::movable T, class Scheduler >
+class OneshotState
+{
+  public:
+    // Value is written, SenderGone is set with it or when the sender is dropped without sending
+    static constexpr std::uint32_t Value = 1;
+    static constexpr std::uint32_t SenderGone = 2;
+    static constexpr std::uint32_t ReceiverGone = 4;
+    static constexpr std::uint32_t Parked = 8;
+
+    static std::tuple< OneshotSender< T, Scheduler >, OneshotReceiver< T, Scheduler > > open(
+        std::pmr::memory_resource* resource, const Scheduler& scheduler )
+    {
+        void* memory = resource->allocate( sizeof( OneshotState ), alignof( OneshotState ) );
+        OneshotState* state;
+        try
+        {
+            state = new( memory ) OneshotState( resource, scheduler );
+        }
+        catch( ... )
+        {
+            resource->deallocate( memory, sizeof( OneshotState ), alignof( OneshotState ) );
+            throw;
+        }
+
+        return { OneshotSender< T, Scheduler >{ state }, OneshotReceiver< T, Scheduler >{ state } };
+    }
+
+    ~OneshotState()
+    {
+        if( state.load( std::memory_order_relaxed ) & Value )
+        {
+            std::destroy_at( slot() );
+        }
+    }
+
+    TryResult send( T&& value )
+    {
+        if( state.load( std::memory_order_relaxed ) & ReceiverGone )
+        {
+            dropSender();
+            return TryResult::Closed;
+        }
+
+        std::construct_at( slot(), std::move( value ) );
+        const auto previous = state.fetch_or( Value | SenderGone, std::memory_order_acq_rel );
+        if( previous & ReceiverGone )
+        {
+            destroy();
+            return TryResult::Closed;
+        }
+
+        if( previous & Parked )
+        {
+            wake();
+        }
+
+        return TryResult::Ok;
+    }
+
+    void dropSender()
+    {
+        const auto previous = state.fetch_or( SenderGone, std::memory_order_acq_rel );
+        if( previous & ReceiverGone )
+        {
+            destroy();
+            return;
+        }
+
+        if( previous & Parked )
+        {
+            wake();
+        }
+    }
+
+    void dropReceiver()
+    {
+        if( state.fetch_or( ReceiverGone, std::memory_order_acq_rel ) & SenderGone )
+        {
+            destroy();
+        }
+    }
+
+    bool isReady() const
+    {
+        return state.load( std::memory_order_acquire ) & SenderGone;
+    }
+
+    // Returns whether the receiver got parked, false if the sender is already done
+    bool park( std::coroutine_handle<> handle )
+    {
+        receiver = handle;
+        return !( state.fetch_or( Parked, std::memory_order_acq_rel ) & SenderGone );
+    }
+
+    // Only called by the receiver once SenderGone is observed
+    std::optional< T > take()
+    {
+        if( !( state.load( std::memory_order_relaxed ) & Value ) )
+        {
+            return std::nullopt;
+        }
+
+        std::optional< T > result( std::move( *slot() ) );
+        std::destroy_at( slot() );
+        state.fetch_and( ~Value, std::memory_order_relaxed );
+        return result;
+    }
+
+  private:
+    OneshotState( std::pmr::memory_resource* theResource, const Scheduler& theScheduler )
+        : resource( theResource )
+        , scheduler( theScheduler )
+    {
+    }
+
+    T* slot()
+    {
+        return reinterpret_cast< T* >( storage );
+    }
+
+    // The receiver may destroy the block as soon as it resumes
+    void wake()
+    {
+        auto theScheduler = scheduler;
+        scheduleOn( theScheduler, receiver );
+    }
+
+    void destroy()
+    {
+        std::pmr::memory_resource* memory = resource;
+        std::destroy_at( this );
+        memory->deallocate( this, sizeof( OneshotState ), alignof( OneshotState ) );
+    }
+
+    std::pmr::memory_resource* resource;
+    [[no_unique_address]] Scheduler scheduler;
+    std::coroutine_handle<> receiver;
+    std::atomic_uint32_t state = 0;
+    alignas( T ) std::byte storage[ sizeof( T ) ];
+};
+
+// Sends at most one value. Dropping it without sending closes the channel
+template< class T, class Scheduler = ScheduleFunc >
+class OneshotSender
+{
+  public:
+    OneshotSender() = delete;
+    OneshotSender( const OneshotSender& ) = delete;
+    OneshotSender( OneshotSender&& other ) noexcept
+        : state( std::exchange( other.state, nullptr ) )
+    {
+    }
+
+    ~OneshotSender()
+    {
+        if( state )
+        {
+            state->dropSender();
+        }
+    }
+
+    OneshotSender& operator=( const OneshotSender& ) = delete;
+    OneshotSender& operator=( OneshotSender&& ) = delete;
+
+    // Never suspends. Closed if the receiver is gone, the value is dropped then. The sender is spent either way
+    TryResult send( T value )
+    {
+        COCHAN_ASSERT( state, "Oneshot value already sent" );
+        return std::exchange( state, nullptr )->send( std::move( value ) );
+    }
+
+  private:
+    explicit OneshotSender( OneshotState< T, Scheduler >* theState )
+        : state( theState )
+    {
+    }
+
+    friend OneshotState< T, Scheduler >;
+
+    OneshotState< T, Scheduler >* state;
+};
+
+template< class T, class Scheduler >
+class AwaitableOneshotReceive
+{
+  public:
+    bool await_ready()
+    {
+        return state->isReady();
+    }
+
+    bool await_suspend( std::coroutine_handle<> handle )
+    {
+        return state->park( handle );
+    }
+
+    std::optional< T > await_resume()
+    {
+        return state->take();
+    }
+
+  private:
+    explicit AwaitableOneshotReceive( OneshotState< T, Scheduler >* theState )
+        : state( theState )
+    {
+    }
+
+    friend OneshotReceiver< T, Scheduler >;
+
+    OneshotState< T, Scheduler >* state;
+};
+
+// Receives the value, or std::nullopt once the sender is dropped without sending.
+// Awaiting again after that resumes right away with std::nullopt
+template< class T, class Scheduler = ScheduleFunc >
+class OneshotReceiver
+{
+  public:
+    OneshotReceiver() = delete;
+    OneshotReceiver( const OneshotReceiver& ) = delete;
+    OneshotReceiver( OneshotReceiver&& other ) noexcept
+        : state( std::exchange( other.state, nullptr ) )
+    {
+    }
+
+    ~OneshotReceiver()
+    {
+        if( state )
+        {
+            state->dropReceiver();
+        }
+    }
+
+    OneshotReceiver& operator=( const OneshotReceiver& ) = delete;
+    OneshotReceiver& operator=( OneshotReceiver&& ) = delete;
+
+    // The receiver has to outlive the returned awaitable
+    AwaitableOneshotReceive< T, Scheduler > receive()
+    {
+        return AwaitableOneshotReceive< T, Scheduler >( state );
+    }
+
+    // Never suspends. result is set only on TryResult::Ok, otherwise the result is Empty or Closed
+    TryResult tryReceive( std::optional< T >& result )
+    {
+        if( !state->isReady() )
+        {
+            return TryResult::Empty;
+        }
+
+        auto value = state->take();
+        if( !value )
+        {
+            return TryResult::Closed;
+        }
+
+        result = std::move( value );
+        return TryResult::Ok;
+    }
+
+  private:
+    explicit OneshotReceiver( OneshotState< T, Scheduler >* theState )
+        : state( theState )
+    {
+    }
+
+    friend OneshotState< T, Scheduler >;
+
+    OneshotState< T, Scheduler >* state;
+};
+
+// Reply slot for request/response flows: one value, no mutex, a single allocation for the control block
+template< class T, class Scheduler = ScheduleFunc >
+std::tuple< OneshotSender< T, Scheduler >, OneshotReceiver< T, Scheduler > > makeOneshot(
+    const std::type_identity_t< Scheduler >& scheduler = defaultScheduleFunc,
+    std::pmr::memory_resource* resource = std::pmr::new_delete_resource() )
+{
+    return OneshotState< T, Scheduler >::open( resource, scheduler );
+}
+
+} // namespace cochan
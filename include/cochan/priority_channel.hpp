@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <memory_resource>
+#include <optional>
+#include <functional>
+#include <tuple>
+#include <vector>
+#include <algorithm>
+
+#include <cochan/channel.hpp>
+
+namespace cochan
+{
+
+// Binary heap over a buffer reserved for capacity elements up front, so pushes never allocate.
+// Receivers get the greatest element according to Compare first, like std::priority_queue; equal ones
+// come out in the order they were sent. Guarded by the heap's own mutex, like SegmentedQueue.
+template< std::movable T, class Compare = std::less< T > >
+class PriorityHeap
+{
+  public:
+    explicit PriorityHeap( std::size_t theCapacity, std::pmr::memory_resource* theResource = std::pmr::new_delete_resource(), Compare theCompare = {} )
+        : capacity( theCapacity )
+        , heap( theResource )
+        , compare( std::move( theCompare ) )
+    {
+        heap.reserve( capacity );
+    }
+
+    PriorityHeap( const PriorityHeap& ) = delete;
+    PriorityHeap& operator=( const PriorityHeap& ) = delete;
+
+    // value is moved from only on success
+    bool tryPush( T& value )
+    {
+        const std::lock_guard< std::mutex > guard( mutex );
+        if( heap.size() == capacity )
+        {
+            return false;
+        }
+
+        heap.push_back( Entry{ std::move( value ), sequence++ } );
+        std::push_heap( heap.begin(), heap.end(), lower );
+        return true;
+    }
+
+    bool tryPop( std::optional< T >& result )
+    {
+        const std::lock_guard< std::mutex > guard( mutex );
+        if( heap.empty() )
+        {
+            return false;
+        }
+
+        std::pop_heap( heap.begin(), heap.end(), lower );
+        result = std::move( heap.back().value );
+        heap.pop_back();
+        return true;
+    }
+
+    std::size_t size() const
+    {
+        const std::lock_guard< std::mutex > guard( mutex );
+        return heap.size();
+    }
+
+  private:
+    struct Entry
+    {
+        T value;
+        std::uint64_t sequence;
+    };
+
+    // Entry that should come out later sorts lower
+    struct Lower
+    {
+        bool operator()( const Entry& lhs, const Entry& rhs ) const
+        {
+            if( ( *compare )( lhs.value, rhs.value ) )
+            {
+                return true;
+            }
+
+            if( ( *compare )( rhs.value, lhs.value ) )
+            {
+                return false;
+            }
+
+            return lhs.sequence > rhs.sequence;
+        }
+
+        const Compare* compare;
+    };
+
+    const std::size_t capacity;
+
+    mutable std::mutex mutex;
+    std::pmr::vector< Entry > heap;
+    Compare compare;
+    const Lower lower{ &compare };
+    std::uint64_t sequence = 0;
+};
+
+// Same Sender/Receiver API and suspension semantics as Channel, but queued values are delivered greatest first.
+// A value handed straight to a parked receiver skips the heap, there is nothing queued to overtake then.
+// Senders parked on a full heap are admitted in the order they parked, as in Channel, and only get ordered by
+// priority once they are in the heap. Size the capacity so urgent values rarely have to park.
+template< class T, class Compare = std::less< T >, class Scheduler = ScheduleFunc, class Stats = NoStats >
+using PriorityChannel = Channel< T, PriorityHeap< T, Compare >, Scheduler, Stats >;
+
+template< class T, class Compare = std::less< T >, class Scheduler = ScheduleFunc, class Stats = NoStats >
+std::tuple< Sender< T, PriorityChannel< T, Compare, Scheduler, Stats > >, Receiver< T, PriorityChannel< T, Compare, Scheduler, Stats > > > makePriorityChannel(
+    std::size_t capacity = 1, const std::type_identity_t< Scheduler >& scheduler = defaultScheduleFunc,
+    std::pmr::memory_resource* resource = std::pmr::new_delete_resource(), Compare compare = {} )
+{
+    return PriorityChannel< T, Compare, Scheduler, Stats >::open( resource, capacity, scheduler, std::move( compare ) );
+}
+
+} // namespace cochan
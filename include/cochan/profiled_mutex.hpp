@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <mutex>
+
+namespace cochan
+{
+
+// Places in Channel that take its mutex. Drops are told apart by the kind of owner being destroyed
+enum class LockSite : std::uint8_t
+{
+    HandleSend,
+    HandleReceive,
+    TrySend,
+    TryReceive,
+    ReleaseReceivers,
+    ReleaseSenders,
+    Unpark,
+    DropSender,
+    DropReceiver,
+    DropAwaitableSender,
+    DropAwaitableReceiver,
+};
+
+inline constexpr std::size_t lockSiteCount = 11;
+
+// Bucket i counts durations in [2^(i-1), 2^i) nanoseconds, bucket 0 is under 1ns and the last one is open-ended
+inline constexpr std::size_t lockHistogramSize = 32;
+
+struct LockSiteSnapshot
+{
+    std::uint64_t acquisitions = 0;
+    // Acquisitions that found the mutex taken and had to wait
+    std::uint64_t contended = 0;
+    std::chrono::nanoseconds waitTime{ 0 };
+    std::chrono::nanoseconds holdTime{ 0 };
+    // Wait of contended acquisitions only
+    std::array< std::uint64_t, lockHistogramSize > waitHistogram{};
+    std::array< std::uint64_t, lockHistogramSize > holdHistogram{};
+};
+
+using LockSnapshot = std::array< LockSiteSnapshot, lockSiteCount >;
+
+// std::mutex taking the call site on lock. Uncontended acquisitions are a try_lock plus two clock reads,
+// contended ones are timed until the lock is got. Counters are relaxed, the site and start of the current
+// hold are plain members only touched by the holder.
+class ProfiledMutex
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    void lock( LockSite site )
+    {
+        Site& counters = sites[ static_cast< std::size_t >( site ) ];
+        if( !mutex.try_lock() )
+        {
+            const auto start = Clock::now();
+            mutex.lock();
+            const auto waited = Clock::now() - start;
+
+            counters.contended.fetch_add( 1, std::memory_order_relaxed );
+            counters.wait.add( waited );
+        }
+
+        counters.acquisitions.fetch_add( 1, std::memory_order_relaxed );
+        holder = site;
+        acquiredAt = Clock::now();
+    }
+
+    void unlock()
+    {
+        const auto held = Clock::now() - acquiredAt;
+        sites[ static_cast< std::size_t >( holder ) ].hold.add( held );
+        mutex.unlock();
+    }
+
+    LockSnapshot snapshot() const
+    {
+        LockSnapshot result;
+        for( std::size_t i = 0; i < lockSiteCount; i++ )
+        {
+            const Site& site = sites[ i ];
+            result[ i ].acquisitions = site.acquisitions.load( std::memory_order_relaxed );
+            result[ i ].contended = site.contended.load( std::memory_order_relaxed );
+            result[ i ].waitTime = site.wait.total();
+            result[ i ].holdTime = site.hold.total();
+            site.wait.copy( result[ i ].waitHistogram );
+            site.hold.copy( result[ i ].holdHistogram );
+        }
+
+        return result;
+    }
+
+  private:
+    class Histogram
+    {
+      public:
+        void add( Clock::duration duration )
+        {
+            const auto nanos = static_cast< std::uint64_t >( std::chrono::duration_cast< std::chrono::nanoseconds >( duration ).count() );
+            const std::size_t bucket = std::min< std::size_t >( std::bit_width( nanos ), lockHistogramSize - 1 );
+            buckets[ bucket ].fetch_add( 1, std::memory_order_relaxed );
+            sum.fetch_add( nanos, std::memory_order_relaxed );
+        }
+
+        std::chrono::nanoseconds total() const
+        {
+            return std::chrono::nanoseconds( sum.load( std::memory_order_relaxed ) );
+        }
+
+        void copy( std::array< std::uint64_t, lockHistogramSize >& out ) const
+        {
+            for( std::size_t i = 0; i < lockHistogramSize; i++ )
+            {
+                out[ i ] = buckets[ i ].load( std::memory_order_relaxed );
+            }
+        }
+
+      private:
+        std::array< std::atomic_uint64_t, lockHistogramSize > buckets{};
+        std::atomic_uint64_t sum = 0;
+    };
+
+    struct Site
+    {
+        std::atomic_uint64_t acquisitions = 0;
+        std::atomic_uint64_t contended = 0;
+        Histogram wait;
+        Histogram hold;
+    };
+
+    std::mutex mutex;
+    LockSite holder = LockSite::HandleSend;
+    Clock::time_point acquiredAt;
+    std::array< Site, lockSiteCount > sites;
+};
+
+// Locks mutex on behalf of site, only a ProfiledMutex cares which one
+inline std::unique_lock< std::mutex > lockAt( std::mutex& mutex, LockSite )
+{
+    return std::unique_lock< std::mutex >( mutex );
+}
+
+inline std::unique_lock< ProfiledMutex > lockAt( ProfiledMutex& mutex, LockSite site )
+{
+    mutex.lock( site );
+    return std::unique_lock< ProfiledMutex >( mutex, std::adopt_lock );
+}
+
+} // namespace cochan
@@ -3,23 +3,22 @@
 #include <iostream>
 #include <coroutine>
 #include <memory>
+#include <vector>
 
 #include <cochan/channel.hpp>
+#include <cochan/interrupt.hpp>
 
 namespace cochan
 {
 
-template< class T >
-class Receiver;
-
-template< class T >
+template< class T, class Chan >
 class AwaitableReceive
 {
   public:
     AwaitableReceive() = delete;
     AwaitableReceive( AwaitableReceive&& other ) noexcept
-        : result( std::move( other.result ) )
-        , chan( other.chan )
+        : chan( other.chan )
+        , result( std::move( other.result ) )
     {
         other.chan = nullptr;
     }
@@ -33,31 +32,189 @@ class AwaitableReceive
             return;
         }
 
-        std::unique_lock< std::mutex > guard( chan->mutex );
-        if( --chan->awaitableReceivers != 0 || chan->receivers != 0 )
+        chan->dropReceivable( Chan::awaitableReceiverUnit );
+    }
+
+    AwaitableReceive& operator=( const AwaitableReceive& ) = delete;
+    AwaitableReceive& operator=( AwaitableReceive&& ) = delete;
+
+    // Skips suspending altogether when a value is already queued
+    bool await_ready()
+    {
+        return chan->tryReceiveReady( result );
+    }
+
+    bool await_suspend( std::coroutine_handle<> handle )
+    {
+        waiter.slot = &result;
+        waiter.handle = handle;
+        return chan->handleReceive( waiter );
+    }
+
+    std::optional< T > await_resume()
+    {
+        return std::move( result );
+    }
+
+  private:
+    explicit AwaitableReceive( Chan* theChan )
+        : chan( theChan )
+    {
+        chan->retainReceivable( Chan::awaitableReceiverUnit );
+    }
+
+    friend Receiver< T, Chan >;
+    friend SelectCase< AwaitableReceive >;
+
+    Chan* chan;
+    std::optional< T > result;
+    typename Chan::ReceiveWaiter waiter;
+};
+
+// Receive that can be completed from the outside by Trigger, see interrupt.hpp. The waiter carries a WaitState
+// and the trigger completes it with the state itself as the winner, then takes the waiter off the channel.
+// A value handed over first wins the state, so it is never lost.
+template< class T, class Chan, class Trigger >
+class AwaitableInterruptibleReceive
+{
+  public:
+    AwaitableInterruptibleReceive() = delete;
+    AwaitableInterruptibleReceive( AwaitableInterruptibleReceive&& other ) noexcept
+        : chan( other.chan )
+        , trigger( std::move( other.trigger ) )
+        , result( std::move( other.result ) )
+    {
+        other.chan = nullptr;
+    }
+
+    AwaitableInterruptibleReceive( const AwaitableInterruptibleReceive& ) = delete;
+
+    ~AwaitableInterruptibleReceive()
+    {
+        if( !chan )
         {
             return;
         }
 
-        if( chan->senders == 0 && chan->awaitableSenders == 0 )
+        chan->dropReceivable( Chan::awaitableReceiverUnit );
+    }
+
+    AwaitableInterruptibleReceive& operator=( const AwaitableInterruptibleReceive& ) = delete;
+    AwaitableInterruptibleReceive& operator=( AwaitableInterruptibleReceive&& ) = delete;
+
+    bool await_ready()
+    {
+        if( trigger.expired() )
+        {
+            state.complete( &state );
+            return true;
+        }
+
+        return chan->tryReceiveReady( result );
+    }
+
+    bool await_suspend( std::coroutine_handle<> handle )
+    {
+        waiter.slot = &result;
+        waiter.state = &state;
+        waiter.handle = handle;
+        if( !chan->handleReceive( waiter ) )
+        {
+            return false;
+        }
+
+        armed = true;
+        trigger.arm( &fire, this );
+        return !state.arrive();
+    }
+
+    ReceiveResult< T > await_resume()
+    {
+        if( armed )
+        {
+            trigger.disarm();
+        }
+
+        if( state.winner() == &state )
+        {
+            return { Trigger::status, std::nullopt };
+        }
+
+        if( !result )
+        {
+            return { TryResult::Closed, std::nullopt };
+        }
+
+        return { TryResult::Ok, std::move( result ) };
+    }
+
+  private:
+    AwaitableInterruptibleReceive( Chan* theChan, Trigger theTrigger )
+        : chan( theChan )
+        , trigger( std::move( theTrigger ) )
+    {
+        chan->retainReceivable( Chan::awaitableReceiverUnit );
+    }
+
+    static void fire( void* context )
+    {
+        auto* self = static_cast< AwaitableInterruptibleReceive* >( context );
+        if( !self->state.complete( &self->state ) )
         {
-            guard.unlock();
-            delete chan;
             return;
         }
 
-        const auto waitersCopy = chan->collectSendWaiters();
-        chan->closed = true;
-        guard.unlock();
+        self->chan->unpark( self->waiter );
 
-        std::for_each( waitersCopy.begin(), waitersCopy.end(), [ this ]( const auto& el ) {
-            const auto [ val_ptr, handle ] = el;
-            chan->scheduleFunc( handle );
-        } );
+        // Resuming may destroy both the awaitable and the channel
+        const auto handle = self->waiter.handle;
+        auto scheduler = self->chan->scheduler;
+        if( self->state.arrive() )
+        {
+            scheduleOn( scheduler, handle );
+        }
     }
 
-    AwaitableReceive& operator=( const AwaitableReceive& ) = delete;
-    AwaitableReceive& operator=( AwaitableReceive&& ) = delete;
+    friend Receiver< T, Chan >;
+
+    Chan* chan;
+    Trigger trigger;
+    bool armed = false;
+    std::optional< T > result;
+    WaitState state;
+    typename Chan::ReceiveWaiter waiter;
+};
+
+// Resumes with up to maxCount values: whatever is queued, or, if nothing is, the first value to arrive
+// followed by whatever was queued behind it. An empty result means the channel is closed.
+template< class T, class Chan >
+class AwaitableReceiveBatch
+{
+  public:
+    AwaitableReceiveBatch() = delete;
+    AwaitableReceiveBatch( AwaitableReceiveBatch&& other ) noexcept
+        : chan( other.chan )
+        , maxCount( other.maxCount )
+        , values( std::move( other.values ) )
+        , result( std::move( other.result ) )
+    {
+        other.chan = nullptr;
+    }
+
+    AwaitableReceiveBatch( const AwaitableReceiveBatch& ) = delete;
+
+    ~AwaitableReceiveBatch()
+    {
+        if( !chan )
+        {
+            return;
+        }
+
+        chan->dropReceivable( Chan::awaitableReceiverUnit );
+    }
+
+    AwaitableReceiveBatch& operator=( const AwaitableReceiveBatch& ) = delete;
+    AwaitableReceiveBatch& operator=( AwaitableReceiveBatch&& ) = delete;
 
     constexpr bool await_ready()
     {
@@ -66,28 +223,49 @@ class AwaitableReceive
 
     bool await_suspend( std::coroutine_handle<> handle )
     {
-        return chan->handleReceive( std::make_pair( &result, handle ) );
+        if( chan->receiveAvailable( values, maxCount ) != 0 )
+        {
+            return false;
+        }
+
+        waiter.slot = &result;
+        waiter.handle = handle;
+        return chan->handleReceive( waiter );
     }
 
-    std::optional< T > await_resume()
+    std::vector< T > await_resume()
     {
-        return std::move( result );
+        if( result )
+        {
+            values.push_back( std::move( *result ) );
+            result.reset();
+            chan->receiveAvailable( values, maxCount - values.size() );
+        }
+
+        return std::move( values );
     }
 
   private:
-    explicit AwaitableReceive( Channel< T >* theChan )
+    AwaitableReceiveBatch( Chan* theChan, std::size_t theMaxCount, std::vector< T >&& theBuffer )
         : chan( theChan )
+        , maxCount( theMaxCount )
+        , values( std::move( theBuffer ) )
     {
-        chan->awaitableReceivers++;
+        COCHAN_ASSERT_FORMAT( maxCount != 0, "Batch size must be greater than 0" );
+        values.clear();
+        chan->retainReceivable( Chan::awaitableReceiverUnit );
     }
 
-    friend Receiver< T >;
+    friend Receiver< T, Chan >;
 
-    Channel< T >* chan;
+    Chan* chan;
+    std::size_t maxCount;
+    std::vector< T > values;
     std::optional< T > result;
+    typename Chan::ReceiveWaiter waiter;
 };
 
-template< class T >
+template< class T, class Chan >
 class Receiver
 {
   public:
@@ -96,7 +274,7 @@ class Receiver
     Receiver( const Receiver& receiver )
     {
         chan = receiver.chan;
-        chan->receivers++;
+        chan->retainReceivable( Chan::receiverUnit );
     }
 
     Receiver( Receiver&& other ) noexcept
@@ -112,50 +290,66 @@ class Receiver
             return;
         }
 
-        std::unique_lock< std::mutex > guard( chan->mutex );
-        if( --chan->receivers != 0 || chan->awaitableReceivers != 0 )
-        {
-            return;
-        }
+        chan->dropReceivable( Chan::receiverUnit );
+    }
 
-        if( chan->senders == 0 && chan->awaitableSenders == 0 )
-        {
-            guard.unlock();
-            delete chan;
-            return;
-        }
+    void close()
+    {
+        chan->close();
+    }
 
-        const auto waitersCopy = chan->collectSendWaiters();
-        chan->closed = true;
-        guard.unlock();
+    AwaitableReceive< T, Chan > receive()
+    {
+        return AwaitableReceive< T, Chan >( chan );
+    }
 
-        std::for_each( waitersCopy.begin(), waitersCopy.end(), [ this ]( const auto& el ) {
-            const auto [ val_ptr, handle ] = el;
-            chan->scheduleFunc( handle );
-        } );
+    // Never suspends. result is set only on TryResult::Ok, otherwise the result is Empty or Closed
+    TryResult tryReceive( std::optional< T >& result )
+    {
+        return chan->tryReceive( result );
     }
 
-    void close()
+    // Status is TryResult::TimedOut if nothing arrived within timeout
+    template< class Rep, class Period >
+    AwaitableInterruptibleReceive< T, Chan, TimerTrigger > receiveFor( std::chrono::duration< Rep, Period > timeout, TimerSource& timer = defaultTimer() )
+    {
+        return receiveUntil( TimerSource::Clock::now() + std::chrono::ceil< TimerSource::Clock::duration >( timeout ), timer );
+    }
+
+    AwaitableInterruptibleReceive< T, Chan, TimerTrigger > receiveUntil( TimerSource::Clock::time_point deadline, TimerSource& timer = defaultTimer() )
+    {
+        return AwaitableInterruptibleReceive< T, Chan, TimerTrigger >( chan, TimerTrigger( timer, deadline ) );
+    }
+
+    // Status is TryResult::Cancelled once stop is requested on token before a value arrives
+    AwaitableInterruptibleReceive< T, Chan, StopTrigger > receive( std::stop_token token )
+    {
+        return AwaitableInterruptibleReceive< T, Chan, StopTrigger >( chan, StopTrigger( std::move( token ) ) );
+    }
+
+    // buffer is cleared and reused for the result to avoid reallocating on every batch
+    AwaitableReceiveBatch< T, Chan > receiveBatch( std::size_t maxCount, std::vector< T > buffer = {} )
     {
-        chan->closed = true;
+        return AwaitableReceiveBatch< T, Chan >( chan, maxCount, std::move( buffer ) );
     }
 
-    AwaitableReceive< T > receive()
+    // Counters of the whole channel, only with a Stats policy such as ChannelStats
+    ChannelStatsSnapshot stats() const
+        requires( Chan::StatsPolicy::enabled )
     {
-        return AwaitableReceive( chan );
+        return chan->getStats();
     }
 
   private:
-    explicit Receiver( Channel< T >* theChan )
+    explicit Receiver( Chan* theChan )
         : chan( theChan )
     {
-        chan->receivers++;
+        chan->retainReceivable( Chan::receiverUnit );
     }
 
-    template< class U >
-    friend std::tuple< Sender< U >, Receiver< U > > makeChannel( std::size_t capacity, const ScheduleFunc& );
+    friend Chan;
 
-    Channel< T >* chan;
+    Chan* chan;
 };
 
 }; // namespace cochan
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <array>
+#include <span>
+#include <concepts>
+#include <coroutine>
+#include <functional>
+
+namespace cochan
+{
+
+// Type-erased scheduler. Channels use it unless given a scheduler policy, so any callable works and
+// Sender< T >/Receiver< T > name the same channel type regardless of what was passed to makeChannel.
+using ScheduleFunc = std::function< void( std::coroutine_handle<> ) >;
+
+// Scheduler policy: a copyable type with schedule( handle ). Channel stores it by value and calls it directly,
+// so there is no indirect call and, for empty policies, no storage at all.
+template< class S >
+concept SchedulerPolicy = std::copy_constructible< S > && requires( S& scheduler, std::coroutine_handle<> handle ) {
+    scheduler.schedule( handle );
+};
+
+// Policy that can take several coroutines at once, e.g. pushing them to an executor queue under one lock
+// with a single notify. Channel uses it whenever it wakes up more than one waiter.
+template< class S >
+concept BatchSchedulerPolicy = SchedulerPolicy< S > && requires( S& scheduler, std::span< std::coroutine_handle<> > handles ) {
+    scheduler.scheduleBatch( handles );
+};
+
+// Policy declaring static constexpr bool handOff = true. A sender that wakes a parked receiver then resumes it
+// right away on its own thread through symmetric transfer, while the value is still in cache, and goes to
+// schedule() itself instead. Pays off for ping-pong and pipelines on thread pools, pointless with InlineScheduler.
+template< class S >
+concept HandOffSchedulerPolicy = SchedulerPolicy< S > && requires {
+    requires S::handOff;
+};
+
+// Resumes the woken coroutine right away on the waking thread
+struct InlineScheduler
+{
+    void schedule( std::coroutine_handle<> handle ) const
+    {
+        handle.resume();
+    }
+
+    // Lets it be stored in a ScheduleFunc as well
+    void operator()( std::coroutine_handle<> handle ) const
+    {
+        handle.resume();
+    }
+};
+
+inline constexpr InlineScheduler defaultScheduleFunc{};
+
+template< class S >
+void scheduleOn( S& scheduler, std::coroutine_handle<> handle )
+{
+    if constexpr( SchedulerPolicy< S > )
+    {
+        scheduler.schedule( handle );
+    }
+    else
+    {
+        scheduler( handle );
+    }
+}
+
+// Pops and schedules every waiter from the list. A waiter may be gone as soon as its handle is handed over
+// or it is released, so both are the last things done with it. Batches are flushed in chunks to keep them on the stack.
+template< class S, class List >
+void scheduleAll( S& scheduler, List& waiters )
+{
+    if constexpr( BatchSchedulerPolicy< S > )
+    {
+        std::array< std::coroutine_handle<>, 256 > handles;
+        std::size_t count = 0;
+        while( auto* waiter = waiters.pop_front() )
+        {
+            const auto handle = waiter->handle;
+            if( !waiter->release() )
+            {
+                continue;
+            }
+
+            handles[ count++ ] = handle;
+            if( count == handles.size() )
+            {
+                scheduler.scheduleBatch( std::span( handles ) );
+                count = 0;
+            }
+        }
+
+        if( count == 1 )
+        {
+            scheduler.schedule( handles[ 0 ] );
+        }
+        else if( count != 0 )
+        {
+            scheduler.scheduleBatch( std::span( handles.data(), count ) );
+        }
+    }
+    else
+    {
+        while( auto* waiter = waiters.pop_front() )
+        {
+            const auto handle = waiter->handle;
+            if( waiter->release() )
+            {
+                scheduleOn( scheduler, handle );
+            }
+        }
+    }
+}
+
+} // namespace cochan
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstddef>
+#include <coroutine>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include <cochan/channel.hpp>
+#include <cochan/receiver.hpp>
+#include <cochan/sender.hpp>
+#include <cochan/waiter_list.hpp>
+
+namespace cochan
+{
+
+// How select parks, completes and unparks each kind of case
+template< class T, class Chan >
+struct SelectCase< AwaitableReceive< T, Chan > >
+{
+    // std::nullopt if the channel got closed
+    using Result = std::optional< T >;
+
+    static bool park( AwaitableReceive< T, Chan >& awaitable, WaitState& state, std::coroutine_handle<> handle )
+    {
+        awaitable.waiter.slot = &awaitable.result;
+        awaitable.waiter.state = &state;
+        awaitable.waiter.handle = handle;
+        return awaitable.chan->handleReceive( awaitable.waiter );
+    }
+
+    static void unpark( AwaitableReceive< T, Chan >& awaitable )
+    {
+        awaitable.chan->unpark( awaitable.waiter );
+    }
+
+    static const void* waiter( const AwaitableReceive< T, Chan >& awaitable )
+    {
+        return &awaitable.waiter;
+    }
+
+    static Result result( AwaitableReceive< T, Chan >& awaitable )
+    {
+        return std::move( awaitable.result );
+    }
+};
+
+template< class T, class Chan >
+struct SelectCase< AwaitableSend< T, Chan > >
+{
+    // false if the channel got closed and the value was dropped
+    using Result = bool;
+
+    static bool park( AwaitableSend< T, Chan >& awaitable, WaitState& state, std::coroutine_handle<> handle )
+    {
+        awaitable.waiter.slot = &awaitable.value;
+        awaitable.waiter.state = &state;
+        awaitable.waiter.handle = handle;
+        return awaitable.chan->handleSend( awaitable.waiter );
+    }
+
+    static void unpark( AwaitableSend< T, Chan >& awaitable )
+    {
+        awaitable.chan->unpark( awaitable.waiter );
+    }
+
+    static const void* waiter( const AwaitableSend< T, Chan >& awaitable )
+    {
+        return &awaitable.waiter;
+    }
+
+    static Result result( AwaitableSend< T, Chan >& awaitable )
+    {
+        return awaitable.waiter.remaining == 0;
+    }
+};
+
+// Waits for whichever case completes first. Every case parks its own waiter on its channel, all of them sharing
+// one WaitState, so exactly one completes and the rest are taken off their channels on resume.
+// Cases are tried starting from a different one each time, round-robin per thread, so a channel that
+// is always ready can't starve the others.
+template< class... Cases >
+class AwaitableSelect
+{
+  public:
+    // Alternative index is the index of the case that completed
+    using Result = std::variant< typename SelectCase< Cases >::Result... >;
+
+    explicit AwaitableSelect( Cases&&... theCases )
+        : cases( std::move( theCases )... )
+    {
+    }
+
+    // Waiters point into the awaitable
+    AwaitableSelect( const AwaitableSelect& ) = delete;
+    AwaitableSelect& operator=( const AwaitableSelect& ) = delete;
+
+    bool await_ready() const
+    {
+        return false;
+    }
+
+    bool await_suspend( std::coroutine_handle<> handle )
+    {
+        const std::size_t start = nextRotation() % sizeof...( Cases );
+        for( std::size_t i = 0; i < sizeof...( Cases ); i++ )
+        {
+            const std::size_t index = ( start + i ) % sizeof...( Cases );
+            if( forCase( index, [ & ]< class Case >( Case& awaitable ) {
+                    return SelectCase< Case >::park( awaitable, state, handle );
+                } ) )
+            {
+                continue;
+            }
+
+            // Completed right here, nobody else is going to resume us
+            if( state.winner() == forCase( index, []< class Case >( Case& awaitable ) {
+                    return SelectCase< Case >::waiter( awaitable );
+                } ) )
+            {
+                return false;
+            }
+
+            // Completed through a case parked before, its waker arrives as well
+            break;
+        }
+
+        return !state.arrive();
+    }
+
+    Result await_resume()
+    {
+        return resume( std::index_sequence_for< Cases... >{} );
+    }
+
+  private:
+    static std::size_t nextRotation()
+    {
+        thread_local std::size_t rotation = 0;
+        return rotation++;
+    }
+
+    template< class F >
+    auto forCase( std::size_t index, F&& f )
+    {
+        return forCase( index, std::forward< F >( f ), std::index_sequence_for< Cases... >{} );
+    }
+
+    template< class F, std::size_t... I >
+    auto forCase( std::size_t index, F&& f, std::index_sequence< I... > )
+    {
+        decltype( f( std::get< 0 >( cases ) ) ) result{};
+        ( ( index == I ? ( result = f( std::get< I >( cases ) ), true ) : false ) || ... );
+        return result;
+    }
+
+    template< std::size_t... I >
+    Result resume( std::index_sequence< I... > )
+    {
+        const void* winner = state.winner();
+        Result result;
+        (
+            [ & ] {
+                using Case = std::tuple_element_t< I, std::tuple< Cases... > >;
+                auto& awaitable = std::get< I >( cases );
+                if( SelectCase< Case >::waiter( awaitable ) == winner )
+                {
+                    result.template emplace< I >( SelectCase< Case >::result( awaitable ) );
+                }
+                else
+                {
+                    SelectCase< Case >::unpark( awaitable );
+                }
+            }(),
+            ... );
+
+        return result;
+    }
+
+    std::tuple< Cases... > cases;
+    WaitState state;
+};
+
+// co_await select( a.receive(), b.receive(), c.send( value ) ) resumes with a std::variant whose index() tells
+// which case completed: std::optional< T > for receives, bool telling whether the value was sent for sends.
+template< class... Cases >
+    requires( !std::is_lvalue_reference_v< Cases > && ... )
+AwaitableSelect< Cases... > select( Cases&&... cases )
+{
+    static_assert( sizeof...( Cases ) != 0, "Nothing to select from" );
+    return AwaitableSelect< Cases... >( std::move( cases )... );
+}
+
+} // namespace cochan
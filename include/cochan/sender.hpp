@@ -3,16 +3,20 @@
 #include <iostream>
 #include <coroutine>
 #include <exception>
+#include <span>
+#include <vector>
+#include <iterator>
+#include <optional>
+#include <tuple>
+#include <type_traits>
 
 #include <cochan/channel.hpp>
+#include <cochan/interrupt.hpp>
 
 namespace cochan
 {
 
-template< class T >
-class Sender;
-
-template< class T >
+template< class T, class Chan >
 class AwaitableSend
 {
   public:
@@ -31,41 +35,136 @@ class AwaitableSend
             return;
         }
 
-        std::unique_lock< std::mutex > guard( chan->mutex );
-        if( --chan->awaitableSenders != 0 || chan->senders != 0 )
+        chan->dropSendable( Chan::awaitableSenderUnit );
+    }
+
+    AwaitableSend& operator=( const AwaitableSend& ) = delete;
+    AwaitableSend& operator=( AwaitableSend&& other ) = delete;
+
+    // Skips suspending altogether when the value fits into the queue. In hand-off mode it always suspends,
+    // so that a receiver woken by the value can be transferred to
+    bool await_ready()
+    {
+        if constexpr( Chan::handOff )
         {
-            return;
+            return false;
+        }
+        else
+        {
+            return chan->trySendReady( value );
         }
+    }
 
-        if( chan->receivers == 0 && chan->awaitableReceivers == 0 )
+    bool await_suspend( std::coroutine_handle<> handle )
+        requires( !Chan::handOff )
+    {
+        waiter.slot = &value;
+        waiter.handle = handle;
+        return chan->handleSend( waiter );
+    }
+
+    std::coroutine_handle<> await_suspend( std::coroutine_handle<> handle )
+        requires( Chan::handOff )
+    {
+        waiter.slot = &value;
+        waiter.handle = handle;
+
+        std::coroutine_handle<> next;
+        if( chan->handleSend( waiter, &next ) )
         {
-            guard.unlock();
-            delete chan;
-            return;
+            return next ? next : std::noop_coroutine();
         }
 
-        const auto waitersCopy = chan->collectReceiveWaiters();
-        chan->closed = true;
-        guard.unlock();
+        if( !next )
+        {
+            return handle;
+        }
 
-        std::for_each( waitersCopy.begin(), waitersCopy.end(), [ this ]( const auto& el ) {
-            const auto [ result, receiverHandle ] = el;
-            *result = std::nullopt;
-            chan->scheduleFunc( receiverHandle );
-        } );
+        // Once scheduled we may be resumed elsewhere and the channel destroyed any moment
+        auto scheduler = chan->scheduler;
+        scheduler.schedule( handle );
+        return next;
     }
 
-    AwaitableSend& operator=( const AwaitableSend& ) = delete;
-    AwaitableSend& operator=( AwaitableSend&& other ) = delete;
+    void await_resume()
+    {
+    }
 
-    bool await_ready() const
+  private:
+    AwaitableSend( const T& theValue, Chan* theChan )
+        : value( theValue )
+        , chan( theChan )
+    {
+        chan->retainSendable( Chan::awaitableSenderUnit );
+    }
+
+    AwaitableSend( T&& theValue, Chan* theChan )
+        : value( std::move( theValue ) )
+        , chan( theChan )
+    {
+        chan->retainSendable( Chan::awaitableSenderUnit );
+    }
+
+    friend Sender< T, Chan >;
+    friend SelectCase< AwaitableSend >;
+
+    T value;
+    Chan* chan;
+    typename Chan::SendWaiter waiter;
+};
+
+// Send whose value is constructed from args only once it is known where it goes: straight into a parked
+// receiver's slot or a free queue cell when there is one, or into the awaitable itself to park on a full channel.
+// args are held by reference, so the awaitable has to be co_awaited within the expression that made it.
+// Never transfers to the woken receiver, it is scheduled even with a HandOffSchedulerPolicy.
+template< class T, class Chan, class... Args >
+class AwaitableEmplace
+{
+  public:
+    AwaitableEmplace( const AwaitableEmplace& ) = delete;
+    AwaitableEmplace( AwaitableEmplace&& other ) noexcept
+        : args( std::move( other.args ) )
+        , chan( other.chan )
+    {
+        other.chan = nullptr;
+    }
+
+    ~AwaitableEmplace()
+    {
+        if( !chan )
+        {
+            return;
+        }
+
+        chan->dropSendable( Chan::awaitableSenderUnit );
+    }
+
+    AwaitableEmplace& operator=( const AwaitableEmplace& ) = delete;
+    AwaitableEmplace& operator=( AwaitableEmplace&& other ) = delete;
+
+    bool await_ready()
     {
-        return false;
+        if constexpr( Chan::template emplacesInPlace< Args... > )
+        {
+            return std::apply( [ this ]( Args&&... theArgs ) { return chan->tryEmplaceReady( std::forward< Args >( theArgs )... ); }, std::move( args ) );
+        }
+        else
+        {
+            construct();
+            return chan->tryEmplaceReady( std::move( *value ) );
+        }
     }
 
     bool await_suspend( std::coroutine_handle<> handle )
     {
-        return chan->handleSend( std::make_pair( &value, handle ) );
+        if( !value )
+        {
+            construct();
+        }
+
+        waiter.slot = &*value;
+        waiter.handle = handle;
+        return chan->handleSend( waiter );
     }
 
     void await_resume()
@@ -73,27 +172,213 @@ class AwaitableSend
     }
 
   private:
-    AwaitableSend( const T& theValue, Channel< T >* theChan )
-        : value( theValue )
+    AwaitableEmplace( Chan* theChan, Args&&... theArgs )
+        : args( std::forward< Args >( theArgs )... )
         , chan( theChan )
     {
-        chan->awaitableSenders++;
+        chan->retainSendable( Chan::awaitableSenderUnit );
+    }
+
+    void construct()
+    {
+        std::apply( [ this ]( Args&&... theArgs ) { value.emplace( std::forward< Args >( theArgs )... ); }, std::move( args ) );
+    }
+
+    friend Sender< T, Chan >;
+
+    // Only references, it stays usable after being moved from
+    std::tuple< Args&&... > args;
+    std::optional< T > value;
+    Chan* chan;
+    typename Chan::SendWaiter waiter;
+};
+
+// Send that can be completed from the outside by Trigger, see AwaitableInterruptibleReceive.
+// The value is dropped when the trigger wins.
+template< class T, class Chan, class Trigger >
+class AwaitableInterruptibleSend
+{
+  public:
+    AwaitableInterruptibleSend( const AwaitableInterruptibleSend& ) = delete;
+    AwaitableInterruptibleSend( AwaitableInterruptibleSend&& other ) noexcept
+        : value( std::move( other.value ) )
+        , chan( other.chan )
+        , trigger( std::move( other.trigger ) )
+    {
+        other.chan = nullptr;
+    }
+
+    ~AwaitableInterruptibleSend()
+    {
+        if( !chan )
+        {
+            return;
+        }
+
+        chan->dropSendable( Chan::awaitableSenderUnit );
+    }
+
+    AwaitableInterruptibleSend& operator=( const AwaitableInterruptibleSend& ) = delete;
+    AwaitableInterruptibleSend& operator=( AwaitableInterruptibleSend&& other ) = delete;
+
+    bool await_ready()
+    {
+        if( trigger.expired() )
+        {
+            state.complete( &state );
+            return true;
+        }
+
+        if( !chan->trySendReady( value ) )
+        {
+            return false;
+        }
+
+        waiter.remaining = 0;
+        return true;
+    }
+
+    bool await_suspend( std::coroutine_handle<> handle )
+    {
+        waiter.slot = &value;
+        waiter.state = &state;
+        waiter.handle = handle;
+        if( !chan->handleSend( waiter ) )
+        {
+            return false;
+        }
+
+        armed = true;
+        trigger.arm( &fire, this );
+        return !state.arrive();
+    }
+
+    // Ok, Closed or Trigger::status
+    TryResult await_resume()
+    {
+        if( armed )
+        {
+            trigger.disarm();
+        }
+
+        if( state.winner() == &state )
+        {
+            return Trigger::status;
+        }
+
+        return waiter.remaining == 0 ? TryResult::Ok : TryResult::Closed;
     }
 
-    AwaitableSend( T&& theValue, Channel< T >* theChan )
+  private:
+    AwaitableInterruptibleSend( T&& theValue, Chan* theChan, Trigger theTrigger )
         : value( std::move( theValue ) )
         , chan( theChan )
+        , trigger( std::move( theTrigger ) )
     {
-        chan->awaitableSenders++;
+        chan->retainSendable( Chan::awaitableSenderUnit );
     }
 
-    friend Sender< T >;
+    static void fire( void* context )
+    {
+        auto* self = static_cast< AwaitableInterruptibleSend* >( context );
+        if( !self->state.complete( &self->state ) )
+        {
+            return;
+        }
+
+        self->chan->unpark( self->waiter );
+
+        // Resuming may destroy both the awaitable and the channel
+        const auto handle = self->waiter.handle;
+        auto scheduler = self->chan->scheduler;
+        if( self->state.arrive() )
+        {
+            scheduleOn( scheduler, handle );
+        }
+    }
+
+    friend Sender< T, Chan >;
 
     T value;
-    Channel< T >* chan;
+    Chan* chan;
+    Trigger trigger;
+    bool armed = false;
+    WaitState state;
+    typename Chan::SendWaiter waiter;
+};
+
+// Sends values one after another, parking at most once per full queue rather than once per value.
+// Values are moved out of the span as they are taken, so it has to outlive the co_await.
+// Resumes with the number of values taken, which is less than requested only if receivers went away.
+template< class T, class Chan >
+class AwaitableSendBatch
+{
+  public:
+    AwaitableSendBatch( const AwaitableSendBatch& ) = delete;
+    AwaitableSendBatch( AwaitableSendBatch&& other ) noexcept
+        : owned( std::move( other.owned ) )
+        , values( other.values )
+        , chan( other.chan )
+    {
+        other.chan = nullptr;
+    }
+
+    ~AwaitableSendBatch()
+    {
+        if( !chan )
+        {
+            return;
+        }
+
+        chan->dropSendable( Chan::awaitableSenderUnit );
+    }
+
+    AwaitableSendBatch& operator=( const AwaitableSendBatch& ) = delete;
+    AwaitableSendBatch& operator=( AwaitableSendBatch&& other ) = delete;
+
+    bool await_ready() const
+    {
+        return values.empty();
+    }
+
+    bool await_suspend( std::coroutine_handle<> handle )
+    {
+        waiter.slot = values.data();
+        waiter.remaining = values.size();
+        waiter.handle = handle;
+        return chan->handleSend( waiter );
+    }
+
+    std::size_t await_resume()
+    {
+        return values.empty() ? 0 : values.size() - waiter.remaining;
+    }
+
+  private:
+    AwaitableSendBatch( std::span< T > theValues, Chan* theChan )
+        : values( theValues )
+        , chan( theChan )
+    {
+        chan->retainSendable( Chan::awaitableSenderUnit );
+    }
+
+    AwaitableSendBatch( std::vector< T >&& theValues, Chan* theChan )
+        : owned( std::move( theValues ) )
+        , values( owned )
+        , chan( theChan )
+    {
+        chan->retainSendable( Chan::awaitableSenderUnit );
+    }
+
+    friend Sender< T, Chan >;
+
+    std::vector< T > owned;
+    std::span< T > values;
+    Chan* chan;
+    typename Chan::SendWaiter waiter;
 };
 
-template< class T >
+template< class T, class Chan >
 class Sender
 {
   public:
@@ -102,7 +387,7 @@ class Sender
     Sender( const Sender& sender )
     {
         chan = sender.chan;
-        chan->senders++;
+        chan->retainSendable( Chan::senderUnit );
     }
 
     Sender( Sender&& other ) noexcept
@@ -118,48 +403,104 @@ class Sender
             return;
         }
 
-        std::unique_lock< std::mutex > guard( chan->mutex );
-        if( --chan->senders != 0 || chan->awaitableSenders != 0 )
+        chan->dropSendable( Chan::senderUnit );
+    }
+
+    AwaitableSend< T, Chan > send( const T& value )
+    {
+        if( chan->closed )
         {
-            return;
+            throw ChannelClosedException{};
         }
 
-        if( chan->receivers == 0 && chan->awaitableReceivers == 0 )
+        return AwaitableSend< T, Chan >{ value, chan };
+    }
+
+    AwaitableSend< T, Chan > send( T&& value )
+    {
+        if( isClosed() )
         {
-            guard.unlock();
-            delete chan;
-            return;
+            throw ChannelClosedException{};
         }
 
-        const auto waitersCopy = chan->collectReceiveWaiters();
-        chan->closed = true;
-        guard.unlock();
+        return AwaitableSend< T, Chan >{ std::forward< T >( value ), chan };
+    }
 
-        std::for_each( waitersCopy.begin(), waitersCopy.end(), [ this ]( const auto& el ) {
-            const auto [ result, receiverHandle ] = el;
-            *result = std::nullopt;
-            chan->scheduleFunc( receiverHandle );
-        } );
+    // Like send( T( args... ) ), minus the moves into the awaitable and on into the channel whenever
+    // the channel has room or a parked receiver. co_await it right away, see AwaitableEmplace
+    template< class... Args >
+        requires std::constructible_from< T, Args&&... >
+    AwaitableEmplace< T, Chan, Args... > emplace( Args&&... args )
+    {
+        if( isClosed() )
+        {
+            throw ChannelClosedException{};
+        }
+
+        return AwaitableEmplace< T, Chan, Args... >{ chan, std::forward< Args >( args )... };
     }
 
-    AwaitableSend< T > send( const T& value )
+    // Resumes with TryResult::TimedOut if the value could not be handed over within timeout
+    template< class Rep, class Period >
+    AwaitableInterruptibleSend< T, Chan, TimerTrigger > sendFor( T value, std::chrono::duration< Rep, Period > timeout, TimerSource& timer = defaultTimer() )
     {
-        if( chan->closed )
+        return sendUntil( std::move( value ), TimerSource::Clock::now() + std::chrono::ceil< TimerSource::Clock::duration >( timeout ), timer );
+    }
+
+    AwaitableInterruptibleSend< T, Chan, TimerTrigger > sendUntil( T value, TimerSource::Clock::time_point deadline, TimerSource& timer = defaultTimer() )
+    {
+        return interruptible( std::move( value ), TimerTrigger( timer, deadline ) );
+    }
+
+    // Resumes with TryResult::Cancelled once stop is requested on token before the value is handed over
+    AwaitableInterruptibleSend< T, Chan, StopTrigger > send( T value, std::stop_token token )
+    {
+        return interruptible( std::move( value ), StopTrigger( std::move( token ) ) );
+    }
+
+    // Never suspends. value is moved from only on TryResult::Ok, otherwise the result is Full or Closed
+    TryResult trySend( T&& value )
+    {
+        return chan->trySend( value );
+    }
+
+    TryResult trySend( const T& value )
+    {
+        T copy = value;
+        return chan->trySend( copy );
+    }
+
+    AwaitableSendBatch< T, Chan > sendBatch( std::span< T > values )
+    {
+        if( isClosed() )
         {
             throw ChannelClosedException{};
         }
 
-        return AwaitableSend{ value, chan };
+        return AwaitableSendBatch< T, Chan >{ values, chan };
     }
 
-    AwaitableSend< T > send( T&& value )
+    // Copies the range up front, pass std::move_iterator to move instead
+    template< std::input_iterator It, std::sentinel_for< It > End >
+    AwaitableSendBatch< T, Chan > sendRange( It first, End last )
     {
         if( isClosed() )
         {
             throw ChannelClosedException{};
         }
 
-        return AwaitableSend{ std::forward< T >( value ), chan };
+        std::vector< T > values;
+        if constexpr( std::sized_sentinel_for< End, It > )
+        {
+            values.reserve( static_cast< std::size_t >( last - first ) );
+        }
+
+        for( ; first != last; ++first )
+        {
+            values.emplace_back( *first );
+        }
+
+        return AwaitableSendBatch< T, Chan >{ std::move( values ), chan };
     }
 
     [[nodiscard]] std::size_t getCapacity() const
@@ -172,17 +513,34 @@ class Sender
         return chan->isClosed();
     }
 
+    // Counters of the whole channel, only with a Stats policy such as ChannelStats
+    ChannelStatsSnapshot stats() const
+        requires( Chan::StatsPolicy::enabled )
+    {
+        return chan->getStats();
+    }
+
   private:
-    Sender( Channel< T >* theChan )
+    Sender( Chan* theChan )
         : chan( theChan )
     {
-        chan->senders++;
+        chan->retainSendable( Chan::senderUnit );
+    }
+
+    template< class Trigger >
+    AwaitableInterruptibleSend< T, Chan, Trigger > interruptible( T&& value, Trigger trigger )
+    {
+        if( isClosed() )
+        {
+            throw ChannelClosedException{};
+        }
+
+        return AwaitableInterruptibleSend< T, Chan, Trigger >{ std::move( value ), chan, std::move( trigger ) };
     }
 
-    template< class U >
-    friend std::tuple< Sender< U >, Receiver< U > > makeChannel( std::size_t capacity, const ScheduleFunc& );
+    friend Chan;
 
-    Channel< T >* chan;
+    Chan* chan;
 };
 
 } // namespace cochan
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <atomic>
+#include <optional>
+#include <memory>
+#include <memory_resource>
+#include <tuple>
+#include <utility>
+
+#include <cochan/utils.hpp>
+#include <cochan/channel.hpp>
+
+namespace cochan
+{
+
+// Bounded single-producer/single-consumer ring. head is written by the consumer only, tail by the
+// producer only, each on its own cache line together with the owner's cached view of the other index,
+// so the common case is one relaxed load plus one release store per operation.
+template< std::movable T >
+class SpscRing
+{
+  public:
+    explicit SpscRing( std::size_t theCapacity, std::pmr::memory_resource* theResource = std::pmr::new_delete_resource() )
+        : capacity( theCapacity )
+        , mask( theCapacity - 1 )
+        , powerOfTwo( theCapacity != 0 && ( theCapacity & ( theCapacity - 1 ) ) == 0 )
+        , allocator( theResource )
+        , storage( theCapacity != 0 ? allocator.allocate( theCapacity ) : nullptr )
+    {
+    }
+
+    SpscRing( const SpscRing& ) = delete;
+    SpscRing& operator=( const SpscRing& ) = delete;
+
+    ~SpscRing()
+    {
+        for( auto position = head.load(); position != tail.load(); position++ )
+        {
+            std::destroy_at( storage + index( position ) );
+        }
+
+        if( storage )
+        {
+            allocator.deallocate( storage, capacity );
+        }
+    }
+
+    // Producer side. value is moved from only on success
+    bool tryPush( T& value )
+    {
+        return tryEmplace( std::move( value ) );
+    }
+
+    // Producer side, args are untouched on failure
+    template< class... Args >
+    bool tryEmplace( Args&&... args )
+    {
+        const auto position = tail.load( std::memory_order_relaxed );
+        if( position - cachedHead == capacity )
+        {
+            cachedHead = head.load( std::memory_order_acquire );
+            if( position - cachedHead == capacity )
+            {
+                return false;
+            }
+        }
+
+        std::construct_at( storage + index( position ), std::forward< Args >( args )... );
+        tail.store( position + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Consumer side
+    bool tryPop( std::optional< T >& result )
+    {
+        const auto position = head.load( std::memory_order_relaxed );
+        if( position == cachedTail )
+        {
+            cachedTail = tail.load( std::memory_order_acquire );
+            if( position == cachedTail )
+            {
+                return false;
+            }
+        }
+
+        T* element = storage + index( position );
+        result = std::move( *element );
+        std::destroy_at( element );
+        head.store( position + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Only a snapshot when both sides are running
+    std::size_t size() const
+    {
+        const auto consumed = head.load( std::memory_order_acquire );
+        return tail.load( std::memory_order_acquire ) - consumed;
+    }
+
+  private:
+    std::size_t index( std::size_t position ) const
+    {
+        return powerOfTwo ? position & mask : position % capacity;
+    }
+
+    const std::size_t capacity;
+    const std::size_t mask;
+    const bool powerOfTwo;
+    std::pmr::polymorphic_allocator< T > allocator;
+    T* const storage;
+
+    alignas( cacheLineSize ) std::atomic_size_t head = 0;
+    std::size_t cachedTail = 0;
+
+    alignas( cacheLineSize ) std::atomic_size_t tail = 0;
+    std::size_t cachedHead = 0;
+};
+
+// Channel for exactly one sending and one receiving coroutine at a time. Sender/Receiver may still be
+// copied or moved around, but operations on the same side must not run concurrently.
+// Channel only touches the ring on behalf of a side while that side is parked, which keeps it single-producer/single-consumer.
+template< class T, class Scheduler = ScheduleFunc, class Stats = NoStats >
+using SpscChannel = Channel< T, SpscRing< T >, Scheduler, Stats >;
+
+template< class T, class Scheduler = ScheduleFunc, class Stats = NoStats >
+std::tuple< Sender< T, SpscChannel< T, Scheduler, Stats > >, Receiver< T, SpscChannel< T, Scheduler, Stats > > > makeSpscChannel(
+    std::size_t capacity = 1, const std::type_identity_t< Scheduler >& scheduler = defaultScheduleFunc,
+    std::pmr::memory_resource* resource = std::pmr::new_delete_resource() )
+{
+    return SpscChannel< T, Scheduler, Stats >::open( resource, capacity, scheduler );
+}
+
+} // namespace cochan
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#include <cochan/utils.hpp>
+#include <cochan/profiled_mutex.hpp>
+#include <cochan/waiter_list.hpp>
+
+namespace cochan
+{
+
+// Counters of one channel at the time of the call. Taken without a lock, fields may be off by operations in flight
+struct ChannelStatsSnapshot
+{
+    std::uint64_t sends = 0;
+    std::uint64_t receives = 0;
+    std::uint64_t senderParks = 0;
+    std::uint64_t receiverParks = 0;
+    // Parked waiters completed and handed to the scheduler, close-time releases included
+    std::uint64_t wakeups = 0;
+    // Parked waiters completed because the other side went away
+    std::uint64_t closeReleases = 0;
+    // Deepest sendQueue seen right after a push
+    std::size_t highWaterMark = 0;
+    // Summed over waiters from parking until this channel woke them. Waiters completed elsewhere, e.g. by
+    // another channel of a select or by a timeout, are not counted
+    std::chrono::nanoseconds parkedTime{ 0 };
+    // Channel's mutex per LockSite, all zero unless the policy is ContentionStats
+    LockSnapshot locks{};
+};
+
+// Stats policy of Channel. Default: every hook is an empty inline function, the member takes no space
+// in the channel and waiters carry no timestamp, so the channel compiles exactly as without it.
+struct NoStats
+{
+    static constexpr bool enabled = false;
+
+    using Stamp = NoStamp;
+    using Mutex = std::mutex;
+
+    void sent( std::size_t = 1 )
+    {
+    }
+
+    void received( std::size_t = 1 )
+    {
+    }
+
+    template< class Queue >
+    void queued( const Queue& )
+    {
+    }
+
+    template< class Node >
+    void senderParked( Node& )
+    {
+    }
+
+    template< class Node >
+    void receiverParked( Node& )
+    {
+    }
+
+    template< class Node >
+    void woken( const Node& )
+    {
+    }
+
+    template< class Node >
+    void woken( const WaiterList< Node >& )
+    {
+    }
+
+    template< class Node >
+    void closeReleased( const WaiterList< Node >& )
+    {
+    }
+};
+
+// Relaxed counters, pass it as Stats to makeChannel and friends and read them through Sender/Receiver::stats().
+// Every hook is a single relaxed RMW except queued, which reads the queue size, and parking, which reads the clock.
+// Written from both sides, so it gets a cache line of its own.
+class alignas( cacheLineSize ) ChannelStats
+{
+  public:
+    static constexpr bool enabled = true;
+
+    using Clock = std::chrono::steady_clock;
+    using Stamp = Clock::time_point;
+    using Mutex = std::mutex;
+
+    void sent( std::size_t count = 1 )
+    {
+        sends.fetch_add( count, std::memory_order_relaxed );
+    }
+
+    void received( std::size_t count = 1 )
+    {
+        receives.fetch_add( count, std::memory_order_relaxed );
+    }
+
+    template< class Queue >
+    void queued( const Queue& queue )
+    {
+        const std::size_t depth = queue.size();
+        std::size_t mark = highWaterMark.load( std::memory_order_relaxed );
+        while( depth > mark && !highWaterMark.compare_exchange_weak( mark, depth, std::memory_order_relaxed ) )
+        {
+        }
+    }
+
+    template< class Node >
+    void senderParked( Node& waiter )
+    {
+        senderParks.fetch_add( 1, std::memory_order_relaxed );
+        waiter.stamp = Clock::now();
+    }
+
+    template< class Node >
+    void receiverParked( Node& waiter )
+    {
+        receiverParks.fetch_add( 1, std::memory_order_relaxed );
+        waiter.stamp = Clock::now();
+    }
+
+    // Called right before the waiter is released, it may be destroyed any moment after that
+    template< class Node >
+    void woken( const Node& waiter )
+    {
+        wakeups.fetch_add( 1, std::memory_order_relaxed );
+        addParked( Clock::now() - waiter.stamp );
+    }
+
+    template< class Node >
+    void woken( const WaiterList< Node >& waiters )
+    {
+        const auto now = Clock::now();
+        std::uint64_t count = 0;
+        Clock::duration parked{ 0 };
+        for( const Node* waiter = waiters.front(); waiter; waiter = waiter->next )
+        {
+            count++;
+            parked += now - waiter->stamp;
+        }
+
+        if( count != 0 )
+        {
+            wakeups.fetch_add( count, std::memory_order_relaxed );
+            addParked( parked );
+        }
+    }
+
+    template< class Node >
+    void closeReleased( const WaiterList< Node >& waiters )
+    {
+        std::uint64_t count = 0;
+        for( const Node* waiter = waiters.front(); waiter; waiter = waiter->next )
+        {
+            count++;
+        }
+
+        closeReleases.fetch_add( count, std::memory_order_relaxed );
+        woken( waiters );
+    }
+
+    ChannelStatsSnapshot snapshot() const
+    {
+        ChannelStatsSnapshot result;
+        result.sends = sends.load( std::memory_order_relaxed );
+        result.receives = receives.load( std::memory_order_relaxed );
+        result.senderParks = senderParks.load( std::memory_order_relaxed );
+        result.receiverParks = receiverParks.load( std::memory_order_relaxed );
+        result.wakeups = wakeups.load( std::memory_order_relaxed );
+        result.closeReleases = closeReleases.load( std::memory_order_relaxed );
+        result.highWaterMark = highWaterMark.load( std::memory_order_relaxed );
+        result.parkedTime = std::chrono::nanoseconds( parkedNanos.load( std::memory_order_relaxed ) );
+        return result;
+    }
+
+  private:
+    void addParked( Clock::duration parked )
+    {
+        parkedNanos.fetch_add( std::chrono::duration_cast< std::chrono::nanoseconds >( parked ).count(), std::memory_order_relaxed );
+    }
+
+    std::atomic_uint64_t sends = 0;
+    std::atomic_uint64_t receives = 0;
+    std::atomic_uint64_t senderParks = 0;
+    std::atomic_uint64_t receiverParks = 0;
+    std::atomic_uint64_t wakeups = 0;
+    std::atomic_uint64_t closeReleases = 0;
+    std::atomic_size_t highWaterMark = 0;
+    std::atomic_uint64_t parkedNanos = 0;
+};
+
+// ChannelStats plus a ProfiledMutex for the channel, so that snapshots also say how often and for how long
+// each call site waited for and held the lock
+class ContentionStats: public ChannelStats
+{
+  public:
+    using Mutex = ProfiledMutex;
+};
+
+} // namespace cochan
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <cochan/utils.hpp>
+
+namespace cochan
+{
+
+// Source of deadlines for receiveFor/sendFor and friends. Plug in your event loop's timers by implementing it.
+class TimerSource
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    virtual ~TimerSource() = default;
+
+    // Calls fire( context ) on some thread once deadline has passed. Returns non-zero id for cancel
+    virtual std::uint64_t add( Clock::time_point deadline, void ( *fire )( void* ), void* context ) = 0;
+
+    // Once it returns fire is neither running nor going to run, unless cancel is called from fire itself
+    virtual void cancel( std::uint64_t id ) = 0;
+};
+
+// Hashed timer wheel driven by its own thread. Meant for tests and simple programs: deadlines are rounded up
+// to the tick and the thread wakes up every tick while any timer is pending.
+class TimerWheel: public TimerSource
+{
+  public:
+    explicit TimerWheel( std::chrono::milliseconds theTick = std::chrono::milliseconds( 1 ), std::size_t theSlotCount = 256 )
+        : tick( theTick )
+        , start( Clock::now() )
+        , slots( theSlotCount )
+    {
+        COCHAN_ASSERT( tick.count() > 0 && !slots.empty(), "Tick and slot count must be greater than 0" );
+        thread = std::thread( [ this ]() {
+            run();
+        } );
+    }
+
+    TimerWheel( const TimerWheel& ) = delete;
+    TimerWheel& operator=( const TimerWheel& ) = delete;
+
+    // Pending timers never fire
+    ~TimerWheel() override
+    {
+        {
+            const std::lock_guard< std::mutex > guard( mutex );
+            stopping = true;
+        }
+
+        wakeup.notify_all();
+        thread.join();
+    }
+
+    std::uint64_t add( Clock::time_point deadline, void ( *fire )( void* ), void* context ) override
+    {
+        std::unique_lock< std::mutex > guard( mutex );
+        const auto id = ++lastId;
+        const auto due = std::max( tickOf( deadline ), currentTick + 1 );
+        const auto slot = due % slots.size();
+        slots[ slot ].push_back( { id, due, fire, context } );
+        slotOf.emplace( id, slot );
+
+        guard.unlock();
+        wakeup.notify_all();
+        return id;
+    }
+
+    void cancel( std::uint64_t id ) override
+    {
+        std::unique_lock< std::mutex > guard( mutex );
+        if( running == id && std::this_thread::get_id() == thread.get_id() )
+        {
+            return;
+        }
+
+        fired.wait( guard, [ & ]() {
+            return running != id;
+        } );
+
+        const auto found = slotOf.find( id );
+        if( found == slotOf.end() )
+        {
+            return;
+        }
+
+        auto& entries = slots[ found->second ];
+        std::erase_if( entries, [ id ]( const Entry& entry ) {
+            return entry.id == id;
+        } );
+
+        slotOf.erase( found );
+    }
+
+  private:
+    struct Entry
+    {
+        std::uint64_t id;
+        std::uint64_t due;
+        void ( *fire )( void* );
+        void* context;
+    };
+
+    // Rounded up, so timers never fire early
+    std::uint64_t tickOf( Clock::time_point deadline ) const
+    {
+        if( deadline <= start )
+        {
+            return 0;
+        }
+
+        return static_cast< std::uint64_t >( ( deadline - start + tick - Clock::duration( 1 ) ) / tick );
+    }
+
+    void run()
+    {
+        std::unique_lock< std::mutex > guard( mutex );
+        while( !stopping )
+        {
+            if( slotOf.empty() )
+            {
+                wakeup.wait( guard, [ this ]() {
+                    return stopping || !slotOf.empty();
+                } );
+
+                continue;
+            }
+
+            wakeup.wait_until( guard, start + tick * ( currentTick + 1 ) );
+
+            const auto now = static_cast< std::uint64_t >( ( Clock::now() - start ) / tick );
+            while( !stopping && currentTick < now )
+            {
+                currentTick++;
+                fireDue( guard, currentTick % slots.size() );
+            }
+        }
+    }
+
+    // Fires one entry at a time with mutex unlocked, so cancel can always tell whether an entry is still pending
+    void fireDue( std::unique_lock< std::mutex >& guard, std::size_t slot )
+    {
+        while( true )
+        {
+            auto& entries = slots[ slot ];
+            const auto entry = std::find_if( entries.begin(), entries.end(), [ this ]( const Entry& candidate ) {
+                return candidate.due <= currentTick;
+            } );
+
+            if( entry == entries.end() )
+            {
+                return;
+            }
+
+            const Entry due = *entry;
+            entries.erase( entry );
+            slotOf.erase( due.id );
+            running = due.id;
+
+            guard.unlock();
+            due.fire( due.context );
+            guard.lock();
+
+            running = 0;
+            fired.notify_all();
+        }
+    }
+
+    const Clock::duration tick;
+    const Clock::time_point start;
+
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::condition_variable fired;
+
+    std::vector< std::vector< Entry > > slots;
+    std::unordered_map< std::uint64_t, std::size_t > slotOf;
+    std::uint64_t currentTick = 0;
+    std::uint64_t lastId = 0;
+    std::uint64_t running = 0;
+    bool stopping = false;
+
+    std::thread thread;
+};
+
+// Used by receiveFor/sendFor when no timer is given. Started on first use
+inline TimerSource& defaultTimer()
+{
+    static TimerWheel wheel;
+    return wheel;
+}
+
+} // namespace cochan
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace cochan
+{
+
+// Park/wake tracing. Define COCHAN_TRACE for the whole program (cmake -DENABLE_TRACING=ON) to have every channel
+// record its parks, wakes and close transitions. Without it the hooks are discarded at compile time.
+#ifdef COCHAN_TRACE
+inline constexpr bool traceEnabled = true;
+#else
+inline constexpr bool traceEnabled = false;
+#endif
+
+enum class TraceKind : std::uint8_t
+{
+    SenderPark,
+    ReceiverPark,
+    Wake,
+    // Last sendable or receivable gone, or Receiver::close
+    Close,
+};
+
+struct TraceEvent
+{
+    TraceKind kind;
+    // steady_clock, nanoseconds
+    std::uint64_t timestamp;
+    const void* channel;
+    const void* handle;
+    std::size_t depth;
+};
+
+// Events of one thread. Only the owning thread writes, overwriting the oldest once full, so recording is a few
+// relaxed stores and never blocks. Each slot is a seqlock: readers drop events overwritten while being copied.
+class TraceBuffer
+{
+  public:
+    static constexpr std::size_t capacity = 8192;
+
+    void record( TraceKind kind, const void* channel, const void* handle, std::size_t depth )
+    {
+        const auto index = head.load( std::memory_order_relaxed );
+        Slot& slot = slots[ index % capacity ];
+        const auto timestamp = std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+
+        slot.sequence.store( 2 * index + 1, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_release );
+        slot.kind.store( kind, std::memory_order_relaxed );
+        slot.timestamp.store( timestamp, std::memory_order_relaxed );
+        slot.channel.store( channel, std::memory_order_relaxed );
+        slot.handle.store( handle, std::memory_order_relaxed );
+        slot.depth.store( depth, std::memory_order_relaxed );
+        slot.sequence.store( 2 * index + 2, std::memory_order_release );
+        head.store( index + 1, std::memory_order_release );
+    }
+
+    // Oldest first. Safe to call while the owner keeps recording
+    void collect( std::vector< TraceEvent >& out ) const
+    {
+        const auto end = head.load( std::memory_order_acquire );
+        const auto begin = end > capacity ? end - capacity : 0;
+        for( auto index = begin; index != end; index++ )
+        {
+            const Slot& slot = slots[ index % capacity ];
+            if( slot.sequence.load( std::memory_order_acquire ) != 2 * index + 2 )
+            {
+                continue;
+            }
+
+            TraceEvent event{ slot.kind.load( std::memory_order_relaxed ), slot.timestamp.load( std::memory_order_relaxed ),
+                              slot.channel.load( std::memory_order_relaxed ), slot.handle.load( std::memory_order_relaxed ),
+                              slot.depth.load( std::memory_order_relaxed ) };
+
+            std::atomic_thread_fence( std::memory_order_acquire );
+            if( slot.sequence.load( std::memory_order_relaxed ) == 2 * index + 2 )
+            {
+                out.push_back( event );
+            }
+        }
+    }
+
+    void clear()
+    {
+        head.store( 0, std::memory_order_relaxed );
+        for( auto& slot : slots )
+        {
+            slot.sequence.store( 0, std::memory_order_relaxed );
+        }
+    }
+
+  private:
+    struct Slot
+    {
+        std::atomic_uint64_t sequence = 0;
+        std::atomic< TraceKind > kind = TraceKind::Wake;
+        std::atomic_uint64_t timestamp = 0;
+        std::atomic< const void* > channel = nullptr;
+        std::atomic< const void* > handle = nullptr;
+        std::atomic_size_t depth = 0;
+    };
+
+    std::atomic_uint64_t head = 0;
+    std::array< Slot, capacity > slots;
+};
+
+// Every thread's buffer, kept alive after the thread exits so its events can still be dumped. The buffer of an
+// exited thread goes to the next thread that starts tracing, which keeps appending to it, so the registry only
+// grows to the most threads ever tracing at once.
+class TraceRegistry
+{
+  public:
+    static TraceRegistry& instance()
+    {
+        static TraceRegistry registry;
+        return registry;
+    }
+
+    // Takes a buffer for the calling thread on its first event and hands it back when the thread exits,
+    // the only times a lock is taken
+    TraceBuffer& local()
+    {
+        thread_local LocalBuffer owner;
+        if( !owner.buffer )
+        {
+            owner.buffer = acquire();
+        }
+
+        return *owner.buffer;
+    }
+
+    // Writes everything recorded so far as Chrome trace JSON, to be opened in Perfetto or chrome://tracing.
+    // Each park is an async slice keyed by the coroutine handle that ends at its wake, so gaps in a pipeline show
+    // as long slices; queue depth of every channel is a counter track and close transitions are instant events.
+    void dumpChromeTrace( std::ostream& out ) const
+    {
+        std::vector< std::vector< TraceEvent > > threads;
+        {
+            const std::lock_guard< std::mutex > guard( mutex );
+            for( const auto& buffer : buffers )
+            {
+                buffer->collect( threads.emplace_back() );
+            }
+        }
+
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        for( std::size_t tid = 0; tid < threads.size(); tid++ )
+        {
+            for( const auto& event : threads[ tid ] )
+            {
+                out << ( first ? "\n" : ",\n" );
+                first = false;
+                writeEvent( out, event, tid );
+            }
+        }
+
+        out << "\n]}\n";
+    }
+
+    // Only while nothing is being traced
+    void clear()
+    {
+        const std::lock_guard< std::mutex > guard( mutex );
+        for( auto& buffer : buffers )
+        {
+            buffer->clear();
+        }
+    }
+
+  private:
+    struct LocalBuffer
+    {
+        ~LocalBuffer()
+        {
+            if( buffer )
+            {
+                TraceRegistry::instance().release( buffer );
+            }
+        }
+
+        TraceBuffer* buffer = nullptr;
+    };
+
+    TraceRegistry() = default;
+
+    TraceBuffer* acquire()
+    {
+        const std::lock_guard< std::mutex > guard( mutex );
+        if( freeBuffers.empty() )
+        {
+            return buffers.emplace_back( std::make_unique< TraceBuffer >() ).get();
+        }
+
+        TraceBuffer* buffer = freeBuffers.back();
+        freeBuffers.pop_back();
+        return buffer;
+    }
+
+    void release( TraceBuffer* buffer )
+    {
+        const std::lock_guard< std::mutex > guard( mutex );
+        freeBuffers.push_back( buffer );
+    }
+
+    static void writeEvent( std::ostream& out, const TraceEvent& event, std::size_t tid )
+    {
+        const auto writeHeader = [ & ]( const char* name, const char* phase ) {
+            const auto fraction = event.timestamp % 1000;
+            out << "{\"name\":\"" << name << "\",\"cat\":\"cochan\",\"ph\":\"" << phase << "\",\"pid\":1,\"tid\":" << tid
+                << ",\"ts\":" << event.timestamp / 1000 << '.' << fraction / 100 << fraction / 10 % 10 << fraction % 10;
+        };
+
+        switch( event.kind )
+        {
+            case TraceKind::SenderPark:
+            case TraceKind::ReceiverPark:
+            case TraceKind::Wake:
+                // Async slices pair up by id, so a wake on any thread closes the park of the same coroutine
+                writeHeader( "parked", event.kind == TraceKind::Wake ? "e" : "b" );
+                out << ",\"id2\":{\"global\":\"" << event.handle << "\"}";
+                break;
+            case TraceKind::Close:
+                writeHeader( "close", "i" );
+                out << ",\"s\":\"g\"";
+                break;
+        }
+
+        const char* side = event.kind == TraceKind::SenderPark ? "send" : event.kind == TraceKind::ReceiverPark ? "receive" : "";
+        out << ",\"args\":{\"channel\":\"" << event.channel << "\",\"side\":\"" << side << "\",\"depth\":" << event.depth << "}},\n";
+
+        writeHeader( "depth", "C" );
+        out << ",\"id\":\"" << event.channel << "\",\"args\":{\"depth\":" << event.depth << "}}";
+    }
+
+    mutable std::mutex mutex;
+    std::vector< std::unique_ptr< TraceBuffer > > buffers;
+    std::vector< TraceBuffer* > freeBuffers;
+};
+
+inline void traceEvent( TraceKind kind, const void* channel, const void* handle, std::size_t depth )
+{
+    TraceRegistry::instance().local().record( kind, channel, handle, depth );
+}
+
+inline void dumpChromeTrace( std::ostream& out )
+{
+    TraceRegistry::instance().dumpChromeTrace( out );
+}
+
+} // namespace cochan
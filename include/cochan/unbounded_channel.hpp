@@ -0,0 +1,228 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <functional>
+#include <tuple>
+#include <algorithm>
+
+#include <cochan/channel.hpp>
+
+namespace cochan
+{
+
+struct UnboundedOptions
+{
+    // Elements per segment
+    std::size_t segmentSize = 64;
+
+    // Emptied segments kept for reuse instead of being freed
+    std::size_t maxFreeSegments = 4;
+
+    // onSoftLimit is called with the current size each time the queue grows past softLimit
+    std::size_t softLimit = std::numeric_limits< std::size_t >::max();
+    std::function< void( std::size_t ) > onSoftLimit = {};
+};
+
+// Queue made of a linked list of fixed-size segments. Segments drained by receivers go to a small free list
+// and are reused by senders, so once the channel is warmed up to its working size pushes don't allocate.
+// capacity is a hard limit, makeUnboundedChannel passes max size_t.
+// Operations are guarded by the queue's own mutex, which is never held while calling into Channel or onSoftLimit.
+template< std::movable T >
+class SegmentedQueue
+{
+  public:
+    explicit SegmentedQueue( std::size_t theCapacity, UnboundedOptions theOptions = {} )
+        : SegmentedQueue( theCapacity, std::pmr::new_delete_resource(), std::move( theOptions ) )
+    {
+    }
+
+    // Segments are allocated from resource
+    SegmentedQueue( std::size_t theCapacity, std::pmr::memory_resource* theResource, UnboundedOptions theOptions = {} )
+        : capacity( theCapacity )
+        , options( std::move( theOptions ) )
+        , resource( theResource )
+    {
+        COCHAN_ASSERT_FORMAT( options.segmentSize != 0, "Segment size must be greater than 0" );
+        head = tail = allocateSegment();
+    }
+
+    SegmentedQueue( const SegmentedQueue& ) = delete;
+    SegmentedQueue& operator=( const SegmentedQueue& ) = delete;
+
+    ~SegmentedQueue()
+    {
+        std::optional< T > drained;
+        while( tryPop( drained ) )
+        {
+        }
+
+        deallocateSegment( head );
+        while( freeSegments )
+        {
+            deallocateSegment( std::exchange( freeSegments, freeSegments->next ) );
+        }
+    }
+
+    // value is moved from only on success
+    bool tryPush( T& value )
+    {
+        std::unique_lock< std::mutex > guard( mutex );
+        if( count == capacity )
+        {
+            return false;
+        }
+
+        if( tailIndex == options.segmentSize )
+        {
+            Segment* segment = freeSegments;
+            if( segment )
+            {
+                freeSegments = segment->next;
+                freeCount--;
+                segment->next = nullptr;
+            }
+            else
+            {
+                segment = allocateSegment();
+            }
+
+            tail->next = segment;
+            tail = segment;
+            tailIndex = 0;
+        }
+
+        std::construct_at( values( tail ) + tailIndex, std::move( value ) );
+        tailIndex++;
+
+        const auto size = ++count;
+        guard.unlock();
+
+        if( size - 1 == options.softLimit && options.onSoftLimit )
+        {
+            options.onSoftLimit( size );
+        }
+
+        return true;
+    }
+
+    bool tryPop( std::optional< T >& result )
+    {
+        const std::lock_guard< std::mutex > guard( mutex );
+        if( count == 0 )
+        {
+            return false;
+        }
+
+        T* element = values( head ) + headIndex;
+        result = std::move( *element );
+        std::destroy_at( element );
+        headIndex++;
+        count--;
+
+        if( head == tail )
+        {
+            // Rewind instead of moving to the next segment
+            if( count == 0 )
+            {
+                headIndex = tailIndex = 0;
+            }
+
+            return true;
+        }
+
+        if( headIndex == options.segmentSize )
+        {
+            recycleSegment( std::exchange( head, head->next ) );
+            headIndex = 0;
+        }
+
+        return true;
+    }
+
+    std::size_t size() const
+    {
+        const std::lock_guard< std::mutex > guard( mutex );
+        return count;
+    }
+
+  private:
+    struct Segment
+    {
+        Segment* next = nullptr;
+    };
+
+    static constexpr std::size_t valuesOffset = ( sizeof( Segment ) + alignof( T ) - 1 ) / alignof( T ) * alignof( T );
+    static constexpr std::size_t segmentAlignment = std::max( alignof( Segment ), alignof( T ) );
+
+    static T* values( Segment* segment )
+    {
+        return reinterpret_cast< T* >( reinterpret_cast< std::byte* >( segment ) + valuesOffset );
+    }
+
+    // Header and elements share one allocation
+    Segment* allocateSegment()
+    {
+        void* memory = resource->allocate( segmentBytes(), segmentAlignment );
+        return std::construct_at( static_cast< Segment* >( memory ) );
+    }
+
+    std::size_t segmentBytes() const
+    {
+        return valuesOffset + options.segmentSize * sizeof( T );
+    }
+
+    void deallocateSegment( Segment* segment )
+    {
+        std::destroy_at( segment );
+        resource->deallocate( segment, segmentBytes(), segmentAlignment );
+    }
+
+    void recycleSegment( Segment* segment )
+    {
+        if( freeCount == options.maxFreeSegments )
+        {
+            deallocateSegment( segment );
+            return;
+        }
+
+        segment->next = freeSegments;
+        freeSegments = segment;
+        freeCount++;
+    }
+
+    const std::size_t capacity;
+    const UnboundedOptions options;
+    std::pmr::memory_resource* const resource;
+
+    mutable std::mutex mutex;
+
+    Segment* head = nullptr;
+    Segment* tail = nullptr;
+    std::size_t headIndex = 0;
+    std::size_t tailIndex = 0;
+    std::size_t count = 0;
+
+    Segment* freeSegments = nullptr;
+    std::size_t freeCount = 0;
+};
+
+// Senders never park: values queue up until receivers catch up. Use onSoftLimit to get notified
+// about runaway growth instead of OOM-ing silently.
+template< class T, class Scheduler = ScheduleFunc, class Stats = NoStats >
+using UnboundedChannel = Channel< T, SegmentedQueue< T >, Scheduler, Stats >;
+
+template< class T, class Scheduler = ScheduleFunc, class Stats = NoStats >
+std::tuple< Sender< T, UnboundedChannel< T, Scheduler, Stats > >, Receiver< T, UnboundedChannel< T, Scheduler, Stats > > > makeUnboundedChannel(
+    UnboundedOptions options = {}, const std::type_identity_t< Scheduler >& scheduler = defaultScheduleFunc,
+    std::pmr::memory_resource* resource = std::pmr::new_delete_resource() )
+{
+    return UnboundedChannel< T, Scheduler, Stats >::open( resource, std::numeric_limits< std::size_t >::max(), scheduler, std::move( options ) );
+}
+
+} // namespace cochan
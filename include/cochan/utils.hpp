@@ -2,6 +2,7 @@
 
 #include <stdexcept>
 #include <format>
+#include <cstddef>
 
 #define COCHAN_ASSERT( condition, message )                                                                                                \
     if( !( condition ) )                                                                                                                   \
@@ -14,3 +15,9 @@
     {                                                                                                                                      \
         throw std::format_error( message );                                                                                                \
     }
+
+namespace cochan
+{
+// Fixed instead of std::hardware_destructive_interference_size, which is not ABI-stable across compiler flags
+inline constexpr std::size_t cacheLineSize = 64;
+} // namespace cochan
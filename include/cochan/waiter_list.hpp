@@ -0,0 +1,269 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <coroutine>
+#include <utility>
+
+namespace cochan
+{
+
+// Completion state shared by waiters parked on several channels at once, see select.hpp. Exactly one of them
+// completes: whoever fills a waiter's slot has to acquire it first and then commit, or abort if it turned out
+// there is nothing to fill it with. Waiters that lost are dropped by the channel when it comes across them.
+class WaitState
+{
+  public:
+    // false if already completed through another waiter. Spins while someone else holds the state between
+    // acquire and commit/abort, which only ever covers a single queue operation.
+    bool acquire()
+    {
+        std::uintptr_t expected = open;
+        while( !word.compare_exchange_weak( expected, busy, std::memory_order_acquire, std::memory_order_relaxed ) )
+        {
+            if( expected == busy )
+            {
+                std::this_thread::yield();
+            }
+            else if( expected != open )
+            {
+                return false;
+            }
+
+            expected = open;
+        }
+
+        return true;
+    }
+
+    void commit( const void* waiter )
+    {
+        word.store( reinterpret_cast< std::uintptr_t >( waiter ), std::memory_order_release );
+    }
+
+    void abort()
+    {
+        word.store( open, std::memory_order_release );
+    }
+
+    // Completes without filling any waiter, e.g. on timeout. false if some waiter completed first
+    bool complete( const void* token )
+    {
+        if( !acquire() )
+        {
+            return false;
+        }
+
+        commit( token );
+        return true;
+    }
+
+    // Waiter or token the state was completed with, nullptr while it is still open
+    const void* winner() const
+    {
+        const auto value = word.load( std::memory_order_acquire );
+        return value == open || value == busy ? nullptr : reinterpret_cast< const void* >( value );
+    }
+
+    // Called once by the owner when it is done parking and once by whoever completed the state.
+    // The second one to arrive resumes the coroutine, so it never resumes while still parking elsewhere.
+    bool arrive()
+    {
+        return gate.exchange( true, std::memory_order_acq_rel );
+    }
+
+  private:
+    static constexpr std::uintptr_t open = 0;
+    static constexpr std::uintptr_t busy = 1;
+
+    std::atomic_uintptr_t word = open;
+    std::atomic_bool gate = false;
+};
+
+// Per-waiter data of a Channel's Stats policy, nothing by default
+struct NoStamp
+{
+};
+
+// Parked coroutine. Lives inside the awaitable that parked it, so parking never allocates.
+// slot points to the value being sent (T) or to the receiver's result (std::optional< T >).
+// Batch senders have remaining values laid out contiguously starting at slot.
+// Waiters without state are always acquired, so acquire/commit/abort/release cost nothing for them.
+template< class Slot, class Stamp = NoStamp >
+struct WaiterNode
+{
+    bool acquire()
+    {
+        return !state || state->acquire();
+    }
+
+    void commit()
+    {
+        if( state )
+        {
+            state->commit( this );
+        }
+    }
+
+    void abort()
+    {
+        if( state )
+        {
+            state->abort();
+        }
+    }
+
+    // Last touch of a completed waiter. false if its owner is still parking and will resume by itself
+    bool release()
+    {
+        return !state || state->arrive();
+    }
+
+    Slot* slot = nullptr;
+    std::size_t remaining = 1;
+    std::coroutine_handle<> handle;
+    WaitState* state = nullptr;
+    WaiterNode* next = nullptr;
+    WaiterNode* prev = nullptr;
+    [[no_unique_address]] Stamp stamp;
+};
+
+// Intrusive FIFO of parked coroutines. Does not own the nodes.
+template< class Node >
+class WaiterList
+{
+  public:
+    WaiterList() = default;
+
+    WaiterList( WaiterList&& other ) noexcept
+        : head( std::exchange( other.head, nullptr ) )
+        , tail( std::exchange( other.tail, nullptr ) )
+        , withState( std::exchange( other.withState, 0 ) )
+    {
+    }
+
+    WaiterList( const WaiterList& ) = delete;
+    WaiterList& operator=( const WaiterList& ) = delete;
+
+    WaiterList& operator=( WaiterList&& other ) noexcept
+    {
+        head = std::exchange( other.head, nullptr );
+        tail = std::exchange( other.tail, nullptr );
+        withState = std::exchange( other.withState, 0 );
+        return *this;
+    }
+
+    bool empty() const
+    {
+        return head == nullptr;
+    }
+
+    // Whether some node has a WaitState, i.e. may be unparked by its owner at any moment
+    bool hasStates() const
+    {
+        return withState != 0;
+    }
+
+    void push_back( Node* node )
+    {
+        node->next = nullptr;
+        node->prev = tail;
+        if( tail )
+        {
+            tail->next = node;
+        }
+        else
+        {
+            head = node;
+        }
+
+        tail = node;
+        countState( node, 1 );
+    }
+
+    Node* front() const
+    {
+        return head;
+    }
+
+    // First node not owned by state, used to skip one's own waiters
+    Node* front_other( const WaitState* state ) const
+    {
+        Node* node = head;
+        while( node && state && node->state == state )
+        {
+            node = node->next;
+        }
+
+        return node;
+    }
+
+    // next is read before returning, so the node may be resumed (and destroyed) right after
+    Node* pop_front()
+    {
+        Node* node = head;
+        if( node )
+        {
+            remove( node );
+        }
+
+        return node;
+    }
+
+    bool contains( const Node* node ) const
+    {
+        return node->prev != nullptr || head == node;
+    }
+
+    // node has to be in this list
+    void remove( Node* node )
+    {
+        if( node->prev )
+        {
+            node->prev->next = node->next;
+        }
+        else
+        {
+            head = node->next;
+        }
+
+        if( node->next )
+        {
+            node->next->prev = node->prev;
+        }
+        else
+        {
+            tail = node->prev;
+        }
+
+        node->next = nullptr;
+        node->prev = nullptr;
+        countState( node, -1 );
+    }
+
+    // Detaches the whole list in O(1)
+    WaiterList splice()
+    {
+        return std::move( *this );
+    }
+
+  private:
+    void countState( const Node* node, int delta )
+    {
+        if constexpr( requires { node->state; } )
+        {
+            if( node->state )
+            {
+                withState += delta;
+            }
+        }
+    }
+
+    Node* head = nullptr;
+    Node* tail = nullptr;
+    std::size_t withState = 0;
+};
+
+} // namespace cochan
@@ -0,0 +1,386 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <coroutine>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <tuple>
+#include <type_traits>
+
+#include <cochan/waiter_list.hpp>
+#include <cochan/scheduler.hpp>
+
+namespace cochan
+{
+
+template< class T, class Scheduler >
+class WatchSender;
+
+template< class T, class Scheduler >
+class WatchReceiver;
+
+// Single slot holding the latest value and its version. Receivers remember the version they last saw,
+// there is no queue: a receiver that was busy for several updates only ever sees the newest one.
+template< class T, class Scheduler >
+class WatchChannel
+{
+  public:
+    using Sender = WatchSender< T, Scheduler >;
+    using Receiver = WatchReceiver< T, Scheduler >;
+
+    template< class U >
+    static std::tuple< Sender, Receiver > open( std::pmr::memory_resource* resource, U&& initial, const Scheduler& scheduler )
+    {
+        void* memory = resource->allocate( sizeof( WatchChannel ), alignof( WatchChannel ) );
+        WatchChannel* chan;
+        try
+        {
+            chan = new( memory ) WatchChannel( resource, std::forward< U >( initial ), scheduler );
+        }
+        catch( ... )
+        {
+            resource->deallocate( memory, sizeof( WatchChannel ), alignof( WatchChannel ) );
+            throw;
+        }
+
+        Sender sender( chan );
+        Receiver receiver( chan, 0 );
+        return { std::move( sender ), std::move( receiver ) };
+    }
+
+  private:
+    struct Waiter
+    {
+        bool release()
+        {
+            return true;
+        }
+
+        Receiver* receiver = nullptr;
+        bool* changed = nullptr;
+        std::coroutine_handle<> handle;
+        Waiter* next = nullptr;
+        Waiter* prev = nullptr;
+    };
+
+    template< class U >
+    WatchChannel( std::pmr::memory_resource* theResource, U&& initial, const Scheduler& theScheduler )
+        : resource( theResource )
+        , scheduler( theScheduler )
+        , value( makeSnapshot( std::forward< U >( initial ) ) )
+    {
+    }
+
+    WatchChannel( const WatchChannel& ) = delete;
+    WatchChannel( WatchChannel&& ) = delete;
+
+    template< class U >
+    std::shared_ptr< const T > makeSnapshot( U&& theValue )
+    {
+        return std::allocate_shared< const T >( std::pmr::polymorphic_allocator< T >( resource ), std::forward< U >( theValue ) );
+    }
+
+    // Every parked watcher is released in one go, a BatchSchedulerPolicy gets them in a single call
+    void releaseAll( std::unique_lock< std::mutex >& guard, bool changed )
+    {
+        auto released = waiters.splice();
+        for( Waiter* waiter = released.front(); waiter; waiter = waiter->next )
+        {
+            *waiter->changed = changed;
+            waiter->receiver->seen = version;
+        }
+
+        // Woken watchers may destroy the channel, don't touch it after the first wake
+        Scheduler schedule = scheduler;
+        guard.unlock();
+
+        scheduleAll( schedule, released );
+    }
+
+    template< class U >
+    void send( U&& theValue )
+    {
+        // The old snapshot is released outside the lock, it may be the last reference
+        auto snapshot = makeSnapshot( std::forward< U >( theValue ) );
+        std::unique_lock< std::mutex > guard( mutex );
+        value.swap( snapshot );
+        version++;
+        releaseAll( guard, true );
+    }
+
+    // Returns whether receiver got parked
+    bool handleChanged( Waiter& waiter )
+    {
+        std::unique_lock< std::mutex > guard( mutex );
+        if( waiter.receiver->seen != version )
+        {
+            waiter.receiver->seen = version;
+            *waiter.changed = true;
+            return false;
+        }
+
+        if( senders == 0 )
+        {
+            *waiter.changed = false;
+            return false;
+        }
+
+        waiters.push_back( &waiter );
+        return true;
+    }
+
+    std::shared_ptr< const T > borrow( Receiver& receiver )
+    {
+        std::lock_guard< std::mutex > guard( mutex );
+        receiver.seen = version;
+        return value;
+    }
+
+    bool hasChanged( const Receiver& receiver )
+    {
+        std::lock_guard< std::mutex > guard( mutex );
+        return receiver.seen != version;
+    }
+
+    std::uint64_t currentVersion()
+    {
+        std::lock_guard< std::mutex > guard( mutex );
+        return version;
+    }
+
+    std::uint64_t seenBy( const Receiver& receiver )
+    {
+        std::lock_guard< std::mutex > guard( mutex );
+        return receiver.seen;
+    }
+
+    void addSender()
+    {
+        std::lock_guard< std::mutex > guard( mutex );
+        senders++;
+    }
+
+    void addReceiver()
+    {
+        std::lock_guard< std::mutex > guard( mutex );
+        receivers++;
+    }
+
+    // Parked watchers resume with false once the last sender is gone
+    void dropSender()
+    {
+        std::unique_lock< std::mutex > guard( mutex );
+        if( --senders != 0 )
+        {
+            return;
+        }
+
+        if( receivers == 0 )
+        {
+            guard.unlock();
+            destroy();
+            return;
+        }
+
+        releaseAll( guard, false );
+    }
+
+    void dropReceiver()
+    {
+        std::unique_lock< std::mutex > guard( mutex );
+        if( --receivers != 0 || senders != 0 )
+        {
+            return;
+        }
+
+        guard.unlock();
+        destroy();
+    }
+
+    void destroy()
+    {
+        std::pmr::memory_resource* memory = resource;
+        std::destroy_at( this );
+        memory->deallocate( this, sizeof( WatchChannel ), alignof( WatchChannel ) );
+    }
+
+    template< class U, class S >
+    friend class AwaitableWatchChanged;
+
+    friend Sender;
+    friend Receiver;
+
+    std::pmr::memory_resource* resource;
+    [[no_unique_address]] Scheduler scheduler;
+
+    std::mutex mutex;
+    std::shared_ptr< const T > value;
+    std::uint64_t version = 0;
+    std::size_t senders = 0;
+    std::size_t receivers = 0;
+
+    WaiterList< Waiter > waiters;
+};
+
+// Resumes with true once there is a version the receiver has not seen, false if every sender is gone
+template< class T, class Scheduler >
+class AwaitableWatchChanged
+{
+  public:
+    constexpr bool await_ready()
+    {
+        return false;
+    }
+
+    bool await_suspend( std::coroutine_handle<> handle )
+    {
+        waiter.changed = &changed;
+        waiter.handle = handle;
+        return waiter.receiver->chan->handleChanged( waiter );
+    }
+
+    bool await_resume()
+    {
+        return changed;
+    }
+
+  private:
+    explicit AwaitableWatchChanged( WatchReceiver< T, Scheduler >* receiver )
+    {
+        waiter.receiver = receiver;
+    }
+
+    friend WatchReceiver< T, Scheduler >;
+
+    bool changed = false;
+    typename WatchChannel< T, Scheduler >::Waiter waiter;
+};
+
+template< class T, class Scheduler = ScheduleFunc >
+class WatchSender
+{
+  public:
+    WatchSender() = delete;
+
+    WatchSender( const WatchSender& other )
+        : chan( other.chan )
+    {
+        chan->addSender();
+    }
+
+    WatchSender( WatchSender&& other ) noexcept
+        : chan( std::exchange( other.chan, nullptr ) )
+    {
+    }
+
+    ~WatchSender()
+    {
+        if( chan )
+        {
+            chan->dropSender();
+        }
+    }
+
+    WatchSender& operator=( const WatchSender& ) = delete;
+    WatchSender& operator=( WatchSender&& ) = delete;
+
+    // Never suspends. Replaces the value, bumps the version and wakes every parked watcher
+    void send( T value )
+    {
+        chan->send( std::move( value ) );
+    }
+
+    // New receiver that has seen the current value
+    WatchReceiver< T, Scheduler > subscribe()
+    {
+        return WatchReceiver< T, Scheduler >( chan, chan->currentVersion() );
+    }
+
+  private:
+    explicit WatchSender( WatchChannel< T, Scheduler >* theChan )
+        : chan( theChan )
+    {
+        chan->addSender();
+    }
+
+    friend WatchChannel< T, Scheduler >;
+
+    WatchChannel< T, Scheduler >* chan;
+};
+
+// Copies remember what they have seen independently
+template< class T, class Scheduler = ScheduleFunc >
+class WatchReceiver
+{
+  public:
+    WatchReceiver() = delete;
+
+    WatchReceiver( const WatchReceiver& other )
+        : WatchReceiver( other.chan, other.chan->seenBy( other ) )
+    {
+    }
+
+    WatchReceiver( WatchReceiver&& other ) noexcept
+        : chan( std::exchange( other.chan, nullptr ) )
+        , seen( other.seen )
+    {
+    }
+
+    ~WatchReceiver()
+    {
+        if( chan )
+        {
+            chan->dropReceiver();
+        }
+    }
+
+    WatchReceiver& operator=( const WatchReceiver& ) = delete;
+    WatchReceiver& operator=( WatchReceiver&& ) = delete;
+
+    // Parks until the version moves past the one last seen, and marks the new one as seen.
+    // The receiver has to outlive the returned awaitable
+    AwaitableWatchChanged< T, Scheduler > changed()
+    {
+        return AwaitableWatchChanged< T, Scheduler >( this );
+    }
+
+    // Latest value without copying it, marked as seen. The snapshot stays valid after newer sends
+    std::shared_ptr< const T > borrow()
+    {
+        return chan->borrow( *this );
+    }
+
+    bool hasChanged() const
+    {
+        return chan->hasChanged( *this );
+    }
+
+  private:
+    WatchReceiver( WatchChannel< T, Scheduler >* theChan, std::uint64_t theSeen )
+        : chan( theChan )
+        , seen( theSeen )
+    {
+        chan->addReceiver();
+    }
+
+    friend WatchChannel< T, Scheduler >;
+    friend WatchSender< T, Scheduler >;
+    friend AwaitableWatchChanged< T, Scheduler >;
+
+    WatchChannel< T, Scheduler >* chan;
+    // Version last seen, only touched under the channel's mutex
+    std::uint64_t seen;
+};
+
+template< class T, class Scheduler = ScheduleFunc >
+std::tuple< WatchSender< T, Scheduler >, WatchReceiver< T, Scheduler > > makeWatch(
+    T initial, const std::type_identity_t< Scheduler >& scheduler = defaultScheduleFunc,
+    std::pmr::memory_resource* resource = std::pmr::new_delete_resource() )
+{
+    return WatchChannel< T, Scheduler >::open( resource, std::move( initial ), scheduler );
+}
+
+} // namespace cochan
@@ -0,0 +1,138 @@
+#include <vector>
+#include <numeric>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+#include "dummy_coro.hpp"
+#include <cochan/cochan.hpp>
+
+using namespace cochan;
+
+MyCoroutine sendBatch( Sender< int > s, std::vector< int > values, std::size_t& sent )
+{
+    sent = co_await s.sendBatch( values );
+}
+
+MyCoroutine sendRange( Sender< int > s, int from, int to )
+{
+    std::vector< int > values( to - from );
+    std::iota( values.begin(), values.end(), from );
+    co_await s.sendRange( values.begin(), values.end() );
+}
+
+MyCoroutine receiveBatches( Receiver< int > r, std::size_t maxCount, std::vector< int >& received, std::vector< std::size_t >& batchSizes )
+{
+    std::vector< int > batch;
+    while( true )
+    {
+        batch = co_await r.receiveBatch( maxCount, std::move( batch ) );
+        if( batch.empty() )
+        {
+            break;
+        }
+
+        batchSizes.push_back( batch.size() );
+        received.insert( received.end(), batch.begin(), batch.end() );
+    }
+}
+
+TEST( BatchTest, BatchFillsQueueAndParks )
+{
+    std::size_t sent = 0;
+    std::vector< int > received;
+    std::vector< std::size_t > batchSizes;
+    auto [ s, r ] = makeChannel< int >( 4 );
+
+    auto sendCoro = sendBatch( std::move( s ), { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 }, sent );
+    ASSERT_FALSE( sendCoro.handle.done() ) << "Sender should park once queue is full.";
+
+    auto receiveCoro = receiveBatches( std::move( r ), 3, received, batchSizes );
+    drop( std::move( sendCoro ) );
+    ASSERT_TRUE( receiveCoro.handle.done() );
+
+    ASSERT_EQ( sent, 10 );
+    ASSERT_EQ( received, std::vector< int >( { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 } ) );
+    for( auto size : batchSizes )
+    {
+        ASSERT_LE( size, 3 );
+    }
+}
+
+TEST( BatchTest, BatchHandsOffToParkedReceivers )
+{
+    std::size_t sent = 0;
+    std::vector< int > first;
+    std::vector< int > second;
+    std::vector< std::size_t > batchSizes;
+    auto [ s, r ] = makeChannel< int >( 0 );
+
+    auto receiveCoro1 = receiveBatches( r, 1, first, batchSizes );
+    auto receiveCoro2 = receiveBatches( r, 1, second, batchSizes );
+    drop( std::move( r ) );
+
+    auto sendCoro = sendBatch( std::move( s ), { 1, 2, 3 }, sent );
+    ASSERT_TRUE( sendCoro.handle.done() ) << "Last value should go to a receiver that re-parked.";
+    drop( std::move( sendCoro ) );
+    ASSERT_TRUE( receiveCoro1.handle.done() );
+    ASSERT_TRUE( receiveCoro2.handle.done() );
+
+    ASSERT_EQ( sent, 3 );
+    ASSERT_EQ( first, std::vector< int >( { 1, 3 } ) );
+    ASSERT_EQ( second, std::vector< int >{ 2 } );
+}
+
+TEST( BatchTest, BatchReportsValuesTakenBeforeClose )
+{
+    std::size_t sent = 0;
+    auto [ s, r ] = makeChannel< int >( 2 );
+
+    auto sendCoro = sendBatch( std::move( s ), { 1, 2, 3, 4 }, sent );
+    ASSERT_FALSE( sendCoro.handle.done() );
+
+    drop( std::move( r ) );
+    ASSERT_TRUE( sendCoro.handle.done() );
+    ASSERT_EQ( sent, 2 );
+}
+
+TEST( BatchTest, MultiThreadRange )
+{
+    constexpr int NUM_SENDERS = 4;
+    constexpr int NUM_SEND_ITEMS = 1000;
+    std::vector< int > received;
+    std::vector< std::size_t > batchSizes;
+    auto [ s, r ] = makeChannel< int >( 8 );
+
+    std::vector< std::thread > threads;
+    for( int i = 0; i < NUM_SENDERS; i++ )
+    {
+        threads.emplace_back( [ s, i ]() {
+            waitDone( sendRange( s, i * NUM_SEND_ITEMS, ( i + 1 ) * NUM_SEND_ITEMS ) );
+        } );
+    }
+
+    drop( std::move( s ) );
+    threads.emplace_back( [ &, r = std::move( r ) ]() {
+        waitDone( receiveBatches( r, 16, received, batchSizes ) );
+    } );
+
+    for( auto& thread : threads )
+    {
+        thread.join();
+    }
+
+    ASSERT_EQ( received.size(), NUM_SENDERS * NUM_SEND_ITEMS );
+    std::sort( received.begin(), received.end() );
+    for( int i = 0; i < NUM_SENDERS * NUM_SEND_ITEMS; i++ )
+    {
+        ASSERT_EQ( received[ i ], i );
+    }
+}
+
+int main( int argc, char** argv )
+{
+    ::testing::InitGoogleTest( &argc, argv );
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,271 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dummy_coro.hpp"
+#include <cochan/cochan.hpp>
+
+using namespace cochan;
+
+MyCoroutine receive( BroadcastReceiver< int > r, std::vector< int >& received )
+{
+    while( true )
+    {
+        auto result = co_await r.receive();
+        if( result.status != TryResult::Ok )
+        {
+            break;
+        }
+
+        received.push_back( *result.value );
+    }
+}
+
+MyCoroutine awaitSend( AwaitableBroadcastSend< int, ScheduleFunc > sending )
+{
+    co_await sending;
+}
+
+void expectInOrder( const std::vector< int >& received, int numSent )
+{
+    ASSERT_EQ( received.size(), numSent );
+    for( int i = 0; i < numSent; i++ )
+    {
+        ASSERT_EQ( received[ i ], i );
+    }
+}
+
+TEST( BroadcastTest, EveryReceiverSeesEveryMessage )
+{
+    constexpr int NUM_SEND_ITEMS = 100;
+    constexpr int NUM_RECEIVERS = 4;
+    auto [ s, r ] = makeBroadcastChannel< int >( 3 );
+
+    std::vector< std::vector< int > > received( NUM_RECEIVERS );
+    std::vector< MyCoroutine > receivers;
+    for( int i = 0; i < NUM_RECEIVERS; i++ )
+    {
+        receivers.push_back( receive( r, received[ i ] ) );
+        ASSERT_FALSE( receivers.back().handle.done() ) << "Receiver should park on empty channel.";
+    }
+
+    drop( std::move( r ) );
+    auto sendCoro = sendCount( std::move( s ), NUM_SEND_ITEMS );
+    ASSERT_TRUE( sendCoro.handle.done() ) << "Coroutines should complete each other within 1 thread.";
+    drop( std::move( sendCoro ) );
+
+    for( int i = 0; i < NUM_RECEIVERS; i++ )
+    {
+        ASSERT_TRUE( receivers[ i ].handle.done() );
+        expectInOrder( received[ i ], NUM_SEND_ITEMS );
+    }
+}
+
+TEST( BroadcastTest, MessageIsShared )
+{
+    auto [ s, r ] = makeBroadcastChannel< std::vector< int > >( 2 );
+    auto other = r;
+
+    std::vector< int > value{ 1, 2, 3 };
+    ASSERT_EQ( s.trySend( value ), TryResult::Ok );
+
+    auto first = r.tryReceive();
+    auto second = other.tryReceive();
+    ASSERT_EQ( first.status, TryResult::Ok );
+    ASSERT_EQ( second.status, TryResult::Ok );
+    ASSERT_EQ( first.value.get(), second.value.get() ) << "Receivers should share one stored message.";
+    ASSERT_EQ( r.tryReceive().status, TryResult::Empty );
+}
+
+TEST( BroadcastTest, SlowestReceiverAppliesBackpressure )
+{
+    auto [ s, r ] = makeBroadcastChannel< int >( 2 );
+    auto slow = r;
+
+    std::vector< int > received;
+    auto receiveCoro = receive( std::move( r ), received );
+
+    int value = 0;
+    ASSERT_EQ( s.trySend( value = 0 ), TryResult::Ok );
+    ASSERT_EQ( s.trySend( value = 1 ), TryResult::Ok );
+    ASSERT_EQ( s.trySend( value = 2 ), TryResult::Full ) << "Slow receiver has not read the oldest message yet.";
+    ASSERT_EQ( value, 2 );
+
+    auto sendCoro = sendCount( s, 2 );
+    ASSERT_FALSE( sendCoro.handle.done() ) << "Sender should park behind the slow receiver.";
+
+    ASSERT_EQ( slow.tryReceive().status, TryResult::Ok );
+    ASSERT_EQ( slow.tryReceive().status, TryResult::Ok );
+    ASSERT_TRUE( sendCoro.handle.done() ) << "Freed slots should take parked sender's values.";
+
+    drop( std::move( slow ) );
+    drop( std::move( s ) );
+    drop( std::move( sendCoro ) );
+    ASSERT_TRUE( receiveCoro.handle.done() );
+    ASSERT_EQ( received, ( std::vector< int >{ 0, 1, 0, 1 } ) );
+}
+
+TEST( BroadcastTest, ParkedSendOutlivesSender )
+{
+    auto [ s, r ] = makeBroadcastChannel< int >( 1 );
+    auto slow = r;
+
+    std::vector< int > received;
+    int value = 0;
+    ASSERT_EQ( s.trySend( value ), TryResult::Ok );
+    auto receiveCoro = receive( std::move( r ), received );
+    ASSERT_FALSE( receiveCoro.handle.done() ) << "Receiver should park once caught up.";
+
+    auto sendCoro = awaitSend( s.send( 1 ) );
+    ASSERT_FALSE( sendCoro.handle.done() ) << "Sender should park behind the slow receiver.";
+
+    drop( std::move( s ) );
+    ASSERT_FALSE( receiveCoro.handle.done() ) << "Parked send should keep the channel open.";
+
+    ASSERT_EQ( slow.tryReceive().status, TryResult::Ok );
+    ASSERT_TRUE( sendCoro.handle.done() );
+    ASSERT_EQ( received, ( std::vector< int >{ 0, 1 } ) );
+
+    drop( std::move( sendCoro ) );
+    ASSERT_TRUE( receiveCoro.handle.done() ) << "Channel should close with the last awaitable.";
+    ASSERT_EQ( *slow.tryReceive().value, 1 );
+    ASSERT_EQ( slow.tryReceive().status, TryResult::Closed );
+}
+
+TEST( BroadcastTest, OverwriteReportsLag )
+{
+    auto [ s, r ] = makeBroadcastChannel< int >( 2, LagPolicy::Overwrite );
+    for( int i = 0; i < 5; i++ )
+    {
+        ASSERT_EQ( s.trySend( i ), TryResult::Ok ) << "Overwrite policy never fills up.";
+    }
+
+    auto lagged = r.tryReceive();
+    ASSERT_EQ( lagged.status, TryResult::Lagged );
+    ASSERT_EQ( lagged.lagged, 3 );
+    ASSERT_EQ( *r.tryReceive().value, 3 );
+    ASSERT_EQ( *r.tryReceive().value, 4 );
+
+    drop( std::move( s ) );
+    ASSERT_EQ( r.tryReceive().status, TryResult::Closed );
+}
+
+TEST( BroadcastTest, Subscribe )
+{
+    auto [ s, r ] = makeBroadcastChannel< int >( 4 );
+    ASSERT_EQ( s.trySend( 1 ), TryResult::Ok );
+
+    auto late = s.subscribe();
+    ASSERT_EQ( late.tryReceive().status, TryResult::Empty ) << "New subscriber only sees later messages.";
+
+    drop( std::move( r ) );
+    drop( std::move( late ) );
+    const int value = 2;
+    ASSERT_EQ( s.trySend( value ), TryResult::Closed );
+}
+
+TEST( BroadcastTest, MultiThread )
+{
+    constexpr int NUM_SEND_ITEMS = 20000;
+    constexpr int NUM_RECEIVERS = 3;
+    auto [ s, r ] = makeBroadcastChannel< int >( 16 );
+
+    std::vector< std::vector< int > > received( NUM_RECEIVERS );
+    std::vector< std::thread > threads;
+    for( int i = 0; i < NUM_RECEIVERS; i++ )
+    {
+        threads.emplace_back( [ r = r, &received, i ]() mutable {
+            MyCoroutine coro = receive( std::move( r ), received[ i ] );
+            waitDone( coro );
+        } );
+    }
+
+    drop( std::move( r ) );
+    threads.emplace_back( [ s = std::move( s ) ]() mutable {
+        MyCoroutine coro = sendCount( std::move( s ), NUM_SEND_ITEMS );
+        waitDone( coro );
+    } );
+
+    for( auto& thread : threads )
+    {
+        thread.join();
+    }
+
+    for( const auto& values : received )
+    {
+        expectInOrder( values, NUM_SEND_ITEMS );
+    }
+}
+
+// Subscribers and copies registered while others drain must never get a message that was already released
+TEST( BroadcastTest, SubscribeWhileDraining )
+{
+    constexpr int NUM_RECEIVERS = 2;
+    constexpr int NUM_SUBSCRIBES = 100000;
+    auto [ s, r ] = makeBroadcastChannel< int >( 2 );
+
+    std::atomic_int missing = 0;
+    std::atomic_bool subscribing = true;
+    const auto check = [ &missing ]( const BroadcastResult< int >& result ) {
+        if( result.status == TryResult::Ok && !result.value )
+        {
+            missing++;
+        }
+    };
+
+    std::vector< std::thread > threads;
+    for( int i = 0; i < NUM_RECEIVERS; i++ )
+    {
+        threads.emplace_back( [ r = r, &check ]() mutable {
+            while( true )
+            {
+                const auto result = r.tryReceive();
+                check( result );
+                if( result.status == TryResult::Closed )
+                {
+                    break;
+                }
+
+                std::this_thread::yield();
+            }
+        } );
+    }
+
+    drop( std::move( r ) );
+    threads.emplace_back( [ s = s, &check, &subscribing ]() mutable {
+        for( int i = 0; i < NUM_SUBSCRIBES; i++ )
+        {
+            auto late = s.subscribe();
+            auto copy = late;
+            check( late.tryReceive() );
+            check( copy.tryReceive() );
+        }
+
+        subscribing = false;
+    } );
+
+    // Keeps the ring moving for as long as subscribers come and go
+    for( int i = 0; subscribing; i++ )
+    {
+        if( s.trySend( i ) == TryResult::Full )
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    drop( std::move( s ) );
+    for( auto& thread : threads )
+    {
+        thread.join();
+    }
+
+    ASSERT_EQ( missing, 0 );
+}
+
+int main( int argc, char** argv )
+{
+    ::testing::InitGoogleTest( &argc, argv );
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,111 @@
+#include <chrono>
+#include <stop_token>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "dummy_coro.hpp"
+#include <cochan/cochan.hpp>
+
+using namespace cochan;
+
+MyCoroutine receive( Receiver< int > r, std::stop_token token, ReceiveResult< int >& result )
+{
+    result = co_await r.receive( token );
+}
+
+MyCoroutine send( Sender< int > s, int value, std::stop_token token, TryResult& result )
+{
+    result = co_await s.send( value, token );
+}
+
+TEST( CancelTest, CancelParkedReceive )
+{
+    auto [ s, r ] = makeChannel< int >( 1 );
+    std::stop_source source;
+    ReceiveResult< int > result{ TryResult::Ok, std::nullopt };
+
+    auto receiveCoro = receive( r, source.get_token(), result );
+    ASSERT_FALSE( receiveCoro.handle.done() );
+
+    source.request_stop();
+    ASSERT_TRUE( receiveCoro.handle.done() ) << "Stop request should resume the receiver inline.";
+    ASSERT_EQ( result.status, TryResult::Cancelled );
+
+    // The cancelled waiter is gone, so the value stays in the channel
+    ASSERT_EQ( s.trySend( 1 ), TryResult::Ok );
+    std::optional< int > value;
+    ASSERT_EQ( r.tryReceive( value ), TryResult::Ok );
+    ASSERT_EQ( value, 1 );
+
+    // Already requested stop doesn't touch the channel
+    ASSERT_EQ( s.trySend( 2 ), TryResult::Ok );
+    auto cancelledCoro = receive( r, source.get_token(), result );
+    ASSERT_TRUE( cancelledCoro.handle.done() );
+    ASSERT_EQ( result.status, TryResult::Cancelled );
+    ASSERT_EQ( r.tryReceive( value ), TryResult::Ok );
+    ASSERT_EQ( value, 2 );
+}
+
+TEST( CancelTest, CancelParkedSend )
+{
+    auto [ s, r ] = makeChannel< int >( 0 );
+    std::stop_source source;
+    TryResult result = TryResult::Ok;
+
+    auto sendCoro = send( s, 1, source.get_token(), result );
+    ASSERT_FALSE( sendCoro.handle.done() );
+
+    source.request_stop();
+    ASSERT_TRUE( sendCoro.handle.done() );
+    ASSERT_EQ( result, TryResult::Cancelled );
+
+    std::optional< int > value;
+    ASSERT_EQ( r.tryReceive( value ), TryResult::Empty ) << "Cancelled value must not be delivered.";
+
+    // Stop requested after the hand-off changes nothing
+    std::stop_source late;
+    auto handedCoro = send( s, 2, late.get_token(), result );
+    ASSERT_EQ( r.tryReceive( value ), TryResult::Ok );
+    ASSERT_TRUE( handedCoro.handle.done() );
+    late.request_stop();
+    ASSERT_EQ( result, TryResult::Ok );
+    ASSERT_EQ( value, 2 );
+}
+
+TEST( CancelTest, RacesWithHandOff )
+{
+    constexpr int NUM_ROUNDS = 2000;
+    auto [ s, r ] = makeChannel< int >( 0 );
+
+    for( int i = 0; i < NUM_ROUNDS; i++ )
+    {
+        std::stop_source source;
+        ReceiveResult< int > result{ TryResult::Empty, std::nullopt };
+        auto receiveCoro = receive( r, source.get_token(), result );
+
+        std::thread canceller( [ &source ]() {
+            source.request_stop();
+        } );
+
+        const bool sent = s.trySend( i ) == TryResult::Ok;
+        canceller.join();
+
+        ASSERT_TRUE( receiveCoro.handle.done() );
+        if( sent )
+        {
+            ASSERT_EQ( result.status, TryResult::Ok ) << "Value handed off to a cancelled receiver got lost.";
+            ASSERT_EQ( result.value, i );
+        }
+        else
+        {
+            ASSERT_EQ( result.status, TryResult::Cancelled );
+        }
+    }
+}
+
+int main( int argc, char** argv )
+{
+    ::testing::InitGoogleTest( &argc, argv );
+    return RUN_ALL_TESTS();
+}
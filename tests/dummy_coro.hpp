@@ -1,5 +1,9 @@
+#include <atomic>
+#include <chrono>
 #include <coroutine>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 struct promise_type;
 
@@ -41,7 +45,25 @@ struct promise_type
         return {};
     }
 
-    std::suspend_always final_suspend() noexcept
+    // Publishes finished once the coroutine is suspended for good, so other threads can wait for it
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        void await_suspend( std::coroutine_handle< promise_type > handle ) noexcept
+        {
+            handle.promise().finished.store( true, std::memory_order_release );
+        }
+
+        void await_resume() noexcept
+        {
+        }
+    };
+
+    FinalAwaiter final_suspend() noexcept
     {
         return {};
     }
@@ -54,4 +76,59 @@ struct promise_type
     void return_void()
     {
     }
+
+    std::atomic_bool finished = false;
 };
+
+// Waits for a coroutine that may finish on another thread. Whatever it wrote is visible afterwards,
+// unlike with polling handle.done()
+inline void waitDone( const MyCoroutine& coro )
+{
+    while( !coro.handle.promise().finished.load( std::memory_order_acquire ) )
+    {
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    }
+}
+
+// Like handle.done(), but safe to call while another thread may be finishing the coroutine
+inline bool isDone( const MyCoroutine& coro )
+{
+    return coro.handle.promise().finished.load( std::memory_order_acquire );
+}
+
+template< class T >
+void drop( T )
+{
+}
+
+template< class Sender >
+MyCoroutine sendOne( Sender s, int value )
+{
+    co_await s.send( value );
+}
+
+// Sends 0, 1, ... numToSend - 1
+template< class Sender >
+MyCoroutine sendCount( Sender s, int numToSend )
+{
+    for( int i = 0; i < numToSend; i++ )
+    {
+        co_await s.send( i );
+    }
+}
+
+// Receives until the channel is closed
+template< class Receiver >
+MyCoroutine receiveInto( Receiver r, std::vector< int >& received )
+{
+    while( true )
+    {
+        auto value = co_await r.receive();
+        if( !value )
+        {
+            break;
+        }
+
+        received.push_back( *value );
+    }
+}
@@ -0,0 +1,150 @@
+#include <array>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dummy_coro.hpp"
+#include <cochan/cochan.hpp>
+
+using namespace cochan;
+
+// Large message counting how often it is moved
+struct Message
+{
+    static inline int moves = 0;
+
+    Message( int theId, int fill ) noexcept
+        : id( theId )
+    {
+        payload.fill( fill );
+    }
+
+    Message( Message&& other ) noexcept
+        : id( other.id )
+        , payload( other.payload )
+    {
+        moves++;
+    }
+
+    Message& operator=( Message&& other ) noexcept
+    {
+        id = other.id;
+        payload = other.payload;
+        moves++;
+        return *this;
+    }
+
+    int id;
+    std::array< int, 64 > payload;
+};
+
+template< class Chan >
+MyCoroutine emplace( Sender< Message, Chan > s, int id, bool& done )
+{
+    co_await s.emplace( id, id * 10 );
+    done = true;
+}
+
+MyCoroutine receive( Receiver< Message > r, std::vector< int >& received, int& movesOnArrival )
+{
+    while( true )
+    {
+        auto message = co_await r.receive();
+        if( !message )
+        {
+            break;
+        }
+
+        movesOnArrival = Message::moves;
+        received.push_back( message->id );
+    }
+}
+
+TEST( EmplaceTest, ConstructsIntoQueue )
+{
+    auto [ s, r ] = makeChannel< Message >( 2 );
+    Message::moves = 0;
+
+    bool done = false;
+    auto sendCoro = emplace( s, 1, done );
+    ASSERT_TRUE( done );
+    ASSERT_EQ( Message::moves, 0 ) << "Value should be constructed in the ring cell.";
+
+    std::optional< Message > result;
+    ASSERT_EQ( r.tryReceive( result ), TryResult::Ok );
+    ASSERT_EQ( result->id, 1 );
+    ASSERT_EQ( result->payload.back(), 10 );
+}
+
+TEST( EmplaceTest, ConstructsIntoParkedReceiver )
+{
+    auto [ s, r ] = makeChannel< Message >( 1 );
+    std::vector< int > received;
+    int movesOnArrival = -1;
+    auto receiveCoro = receive( std::move( r ), received, movesOnArrival );
+
+    Message::moves = 0;
+    {
+        bool done = false;
+        auto sendCoro = emplace( s, 7, done );
+        ASSERT_TRUE( done );
+    }
+
+    ASSERT_EQ( received, ( std::vector< int >{ 7 } ) );
+    ASSERT_EQ( movesOnArrival, 1 ) << "Only the move out of the receiver's slot should be left.";
+
+    Message::moves = 0;
+    ASSERT_EQ( s.trySend( Message( 8, 0 ) ), TryResult::Ok );
+    ASSERT_GT( movesOnArrival, 1 ) << "Plain send should move at least once more.";
+
+    drop( std::move( s ) );
+    ASSERT_TRUE( receiveCoro.handle.done() );
+}
+
+TEST( EmplaceTest, ParksOnFullChannel )
+{
+    auto [ s, r ] = makeChannel< Message >( 1 );
+    ASSERT_EQ( s.trySend( Message( 1, 0 ) ), TryResult::Ok );
+
+    bool done = false;
+    auto sendCoro = emplace( s, 2, done );
+    ASSERT_FALSE( done ) << "Sender should park with the value built in the awaitable.";
+
+    std::optional< Message > result;
+    ASSERT_EQ( r.tryReceive( result ), TryResult::Ok );
+    ASSERT_EQ( result->id, 1 );
+    ASSERT_TRUE( done ) << "Freed slot should take parked sender's value.";
+
+    ASSERT_EQ( r.tryReceive( result ), TryResult::Ok );
+    ASSERT_EQ( result->id, 2 );
+    ASSERT_EQ( result->payload.front(), 20 );
+}
+
+TEST( EmplaceTest, BuildsUpFrontWhenNotInPlace )
+{
+    auto [ s, r ] = makeUnboundedChannel< std::string >();
+    static_assert( !UnboundedChannel< std::string >::emplacesInPlace< std::size_t, char > );
+
+    auto sendCoro = []( Sender< std::string, UnboundedChannel< std::string > > sender ) -> MyCoroutine {
+        co_await sender.emplace( std::size_t{ 3 }, 'x' );
+    }( s );
+    ASSERT_TRUE( sendCoro.handle.done() );
+
+    std::optional< std::string > result;
+    ASSERT_EQ( r.tryReceive( result ), TryResult::Ok );
+    ASSERT_EQ( result, "xxx" );
+}
+
+TEST( EmplaceTest, ThrowsOnClosedChannel )
+{
+    auto [ s, r ] = makeChannel< Message >( 1 );
+    r.close();
+    ASSERT_THROW( s.emplace( 1, 1 ), ChannelClosedException );
+}
+
+int main( int argc, char** argv )
+{
+    ::testing::InitGoogleTest( &argc, argv );
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,158 @@
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dummy_coro.hpp"
+#include <cochan/cochan.hpp>
+
+using namespace cochan;
+
+class CountingResource: public std::pmr::memory_resource
+{
+  public:
+    std::size_t allocations = 0;
+    std::size_t live = 0;
+
+  protected:
+    void* do_allocate( std::size_t bytes, std::size_t alignment ) override
+    {
+        allocations++;
+        live++;
+        return std::pmr::new_delete_resource()->allocate( bytes, alignment );
+    }
+
+    void do_deallocate( void* pointer, std::size_t bytes, std::size_t alignment ) override
+    {
+        live--;
+        std::pmr::new_delete_resource()->deallocate( pointer, bytes, alignment );
+    }
+
+    bool do_is_equal( const std::pmr::memory_resource& other ) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+MyCoroutine receiveAll( Receiver< int > r, int& sum )
+{
+    while( true )
+    {
+        auto value = co_await r.receive();
+        if( !value )
+        {
+            break;
+        }
+
+        sum += *value;
+    }
+}
+
+TEST( MemoryResourceTest, ChannelAndStorageComeFromResource )
+{
+    CountingResource resource;
+    int sum = 0;
+    {
+        auto [ s, r ] = makeChannel< int >( 4, defaultScheduleFunc, &resource );
+        ASSERT_EQ( resource.allocations, 2 ) << "Control block and ring.";
+
+        auto receiveCoro = receiveAll( r, sum );
+        for( int i = 1; i <= 10; i++ )
+        {
+            ASSERT_EQ( s.trySend( i ), TryResult::Ok );
+        }
+
+        drop( std::move( s ) );
+        ASSERT_TRUE( receiveCoro.handle.done() );
+    }
+
+    ASSERT_EQ( sum, 55 );
+    ASSERT_EQ( resource.live, 0 );
+
+    {
+        auto [ s, r ] = makeUnboundedChannel< int >( { .segmentSize = 2 }, defaultScheduleFunc, &resource );
+        for( int i = 0; i < 10; i++ )
+        {
+            ASSERT_EQ( s.trySend( i ), TryResult::Ok );
+        }
+
+        ASSERT_GT( resource.live, 2 ) << "Segments should come from the resource as well.";
+    }
+
+    ASSERT_EQ( resource.live, 0 );
+}
+
+TEST( MemoryResourceTest, BlockPoolRecyclesControlBlocks )
+{
+    {
+        auto [ s, r ] = makeChannel< int >( 4, defaultScheduleFunc, blockPool() );
+        std::optional< int > value;
+        ASSERT_EQ( s.trySend( 1 ), TryResult::Ok );
+        ASSERT_EQ( r.tryReceive( value ), TryResult::Ok );
+    }
+
+    // Same thread, same size: the freed blocks are handed out again
+    std::pmr::memory_resource* pool = blockPool();
+    void* block = pool->allocate( 100, 8 );
+    pool->deallocate( block, 100, 8 );
+    ASSERT_EQ( pool->allocate( 100, 8 ), block );
+    pool->deallocate( block, 100, 8 );
+
+    // Blocks freed on another thread are fine to reuse here
+    void* foreign = nullptr;
+    std::thread( [ & ]() {
+        foreign = pool->allocate( 200, 16 );
+    } ).join();
+    pool->deallocate( foreign, 200, 16 );
+    ASSERT_EQ( pool->allocate( 200, 16 ), foreign );
+    pool->deallocate( foreign, 200, 16 );
+
+    // Channel dropped on another thread than it was created on
+    auto [ s, r ] = makeChannel< int >( 4, defaultScheduleFunc, blockPool() );
+    std::thread( [ s = std::move( s ), r = std::move( r ) ]() {
+    } ).join();
+}
+
+TEST( MemoryResourceTest, BlockPoolLimitCoversSharedCache )
+{
+    constexpr std::size_t BYTES = 1000;
+    BlockPool large( 8 );
+    BlockPool small( 2 );
+
+    // Fresh thread, so its cache starts out empty
+    std::thread( [ & ]() {
+        std::vector< void* > blocks;
+        for( int i = 0; i < 9; i++ )
+        {
+            blocks.push_back( large.allocate( BYTES ) );
+        }
+
+        for( int i = 0; i < 8; i++ )
+        {
+            large.deallocate( blocks[ i ], BYTES );
+        }
+
+        // The thread already caches more than small's limit, so this block goes back to the global allocator
+        small.deallocate( blocks[ 8 ], BYTES );
+        void* reused = small.allocate( BYTES );
+        ASSERT_EQ( reused, blocks[ 7 ] );
+        small.deallocate( reused, BYTES );
+    } ).join();
+}
+
+TEST( MemoryResourceTest, StandardAllocatorThroughAdapter )
+{
+    AllocatorResource< std::allocator< int > > resource;
+    auto [ s, r ] = makeChannel< int >( 4, defaultScheduleFunc, &resource );
+    std::optional< int > value;
+    ASSERT_EQ( s.trySend( 7 ), TryResult::Ok );
+    ASSERT_EQ( r.tryReceive( value ), TryResult::Ok );
+    ASSERT_EQ( value, 7 );
+}
+
+int main( int argc, char** argv )
+{
+    ::testing::InitGoogleTest( &argc, argv );
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,96 @@
+#include <memory>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "dummy_coro.hpp"
+#include <cochan/cochan.hpp>
+
+using namespace cochan;
+
+MyCoroutine receive( OneshotReceiver< std::unique_ptr< int > > r, std::optional< std::unique_ptr< int > >& received )
+{
+    received = co_await r.receive();
+}
+
+TEST( OneshotTest, ReceiverParksUntilSent )
+{
+    std::optional< std::unique_ptr< int > > received;
+    auto [ s, r ] = makeOneshot< std::unique_ptr< int > >();
+
+    auto receiveCoro = receive( std::move( r ), received );
+    ASSERT_FALSE( receiveCoro.handle.done() ) << "Receiver should park until the value is sent.";
+
+    ASSERT_EQ( s.send( std::make_unique< int >( 42 ) ), TryResult::Ok );
+    ASSERT_TRUE( receiveCoro.handle.done() );
+    ASSERT_TRUE( received && *received );
+    ASSERT_EQ( **received, 42 );
+}
+
+TEST( OneshotTest, SentBeforeReceive )
+{
+    auto [ s, r ] = makeOneshot< int >();
+    std::optional< int > value;
+    ASSERT_EQ( r.tryReceive( value ), TryResult::Empty );
+
+    ASSERT_EQ( s.send( 7 ), TryResult::Ok );
+    ASSERT_THROW( s.send( 8 ), std::logic_error ) << "Only one value can be sent.";
+
+    ASSERT_EQ( r.tryReceive( value ), TryResult::Ok );
+    ASSERT_EQ( value, 7 );
+    ASSERT_EQ( r.tryReceive( value ), TryResult::Closed );
+}
+
+TEST( OneshotTest, Closure )
+{
+    {
+        std::optional< std::unique_ptr< int > > received = std::make_unique< int >( 0 );
+        auto [ s, r ] = makeOneshot< std::unique_ptr< int > >();
+        auto receiveCoro = receive( std::move( r ), received );
+        drop( std::move( s ) );
+        ASSERT_TRUE( receiveCoro.handle.done() ) << "Dropping the sender should wake the receiver.";
+        ASSERT_FALSE( received );
+    }
+
+    {
+        auto [ s, r ] = makeOneshot< std::unique_ptr< int > >();
+        drop( std::move( r ) );
+        ASSERT_EQ( s.send( std::make_unique< int >( 1 ) ), TryResult::Closed );
+    }
+
+    {
+        // Value is destroyed with the block if nobody takes it
+        auto value = std::make_shared< int >( 1 );
+        {
+            auto [ s, r ] = makeOneshot< std::shared_ptr< int > >();
+            ASSERT_EQ( s.send( value ), TryResult::Ok );
+        }
+
+        ASSERT_EQ( value.use_count(), 1 );
+    }
+}
+
+TEST( OneshotTest, MultiThread )
+{
+    constexpr int NUM_ROUNDS = 10000;
+    for( int i = 0; i < NUM_ROUNDS; i++ )
+    {
+        std::optional< std::unique_ptr< int > > received;
+        auto [ s, r ] = makeOneshot< std::unique_ptr< int > >();
+        auto receiveCoro = receive( std::move( r ), received );
+
+        std::thread t( [ s = std::move( s ), i ]() mutable {
+            s.send( std::make_unique< int >( i ) );
+        } );
+
+        t.join();
+        ASSERT_TRUE( receiveCoro.handle.done() );
+        ASSERT_EQ( **received, i );
+    }
+}
+
+int main( int argc, char** argv )
+{
+    ::testing::InitGoogleTest( &argc, argv );
+    return RUN_ALL_TESTS();
+}
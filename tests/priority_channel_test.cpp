@@ -0,0 +1,142 @@
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dummy_coro.hpp"
+#include <cochan/cochan.hpp>
+
+using namespace cochan;
+
+struct Job
+{
+    int priority;
+    int id;
+};
+
+struct ByPriority
+{
+    bool operator()( const Job& lhs, const Job& rhs ) const
+    {
+        return lhs.priority < rhs.priority;
+    }
+};
+
+using JobReceiver = Receiver< Job, PriorityChannel< Job, ByPriority > >;
+
+MyCoroutine receive( JobReceiver r, std::vector< int >& received )
+{
+    while( true )
+    {
+        auto job = co_await r.receive();
+        if( !job )
+        {
+            break;
+        }
+
+        received.push_back( job->id );
+    }
+}
+
+TEST( PriorityChannelTest, UrgentOvertakesBacklog )
+{
+    auto [ s, r ] = makePriorityChannel< Job, ByPriority >( 8 );
+    for( int i = 0; i < 5; i++ )
+    {
+        ASSERT_EQ( s.trySend( Job{ 0, i } ), TryResult::Ok );
+    }
+
+    ASSERT_EQ( s.trySend( Job{ 9, 100 } ), TryResult::Ok );
+    ASSERT_EQ( s.trySend( Job{ 5, 101 } ), TryResult::Ok );
+
+    std::vector< int > received;
+    drop( std::move( s ) );
+    auto receiveCoro = receive( std::move( r ), received );
+    ASSERT_TRUE( receiveCoro.handle.done() );
+    ASSERT_EQ( received, ( std::vector< int >{ 100, 101, 0, 1, 2, 3, 4 } ) ) << "Equal priorities should stay in send order.";
+}
+
+TEST( PriorityChannelTest, SenderParksOnFullHeap )
+{
+    auto [ s, r ] = makePriorityChannel< int >( 2 );
+    int value = 1;
+    ASSERT_EQ( s.trySend( value ), TryResult::Ok );
+    ASSERT_EQ( s.trySend( value = 3 ), TryResult::Ok );
+    ASSERT_EQ( s.trySend( value = 2 ), TryResult::Full );
+
+    auto sendCoro = []( Sender< int, PriorityChannel< int > > sender ) -> MyCoroutine {
+        co_await sender.send( 2 );
+    }( s );
+    ASSERT_FALSE( sendCoro.handle.done() ) << "Sender should park on full channel.";
+
+    std::optional< int > result;
+    ASSERT_EQ( r.tryReceive( result ), TryResult::Ok );
+    ASSERT_EQ( result, 3 );
+    ASSERT_TRUE( sendCoro.handle.done() ) << "Freed slot should take parked sender's value.";
+
+    ASSERT_EQ( r.tryReceive( result ), TryResult::Ok );
+    ASSERT_EQ( result, 2 );
+    ASSERT_EQ( r.tryReceive( result ), TryResult::Ok );
+    ASSERT_EQ( result, 1 );
+}
+
+// Not default constructible, values closest to target come out first
+struct ClosestTo
+{
+    explicit ClosestTo( int theTarget )
+        : target( theTarget )
+    {
+    }
+
+    bool operator()( int lhs, int rhs ) const
+    {
+        return std::abs( lhs - target ) > std::abs( rhs - target );
+    }
+
+    int target;
+};
+
+TEST( PriorityChannelTest, StatefulCompare )
+{
+    auto [ s, r ] = makePriorityChannel< int, ClosestTo >( 4, defaultScheduleFunc, std::pmr::new_delete_resource(), ClosestTo( 10 ) );
+    for( int value : { 0, 12, 30, 9 } )
+    {
+        ASSERT_EQ( s.trySend( value ), TryResult::Ok );
+    }
+
+    std::vector< int > received;
+    drop( std::move( s ) );
+    auto receiveCoro = receiveInto( std::move( r ), received );
+    ASSERT_TRUE( receiveCoro.handle.done() );
+    ASSERT_EQ( received, ( std::vector< int >{ 9, 12, 0, 30 } ) );
+}
+
+TEST( PriorityChannelTest, ParkedSendersAdmittedInOrder )
+{
+    auto [ s, r ] = makePriorityChannel< int >( 1 );
+    ASSERT_EQ( s.trySend( 5 ), TryResult::Ok );
+
+    auto low = sendOne( s, 1 );
+    auto high = sendOne( s, 9 );
+    ASSERT_FALSE( low.handle.done() );
+    ASSERT_FALSE( high.handle.done() );
+
+    std::optional< int > result;
+    ASSERT_EQ( r.tryReceive( result ), TryResult::Ok );
+    ASSERT_EQ( result, 5 );
+    ASSERT_TRUE( low.handle.done() );
+    ASSERT_FALSE( high.handle.done() ) << "A parked sender is not overtaken by a later, more urgent one.";
+
+    ASSERT_EQ( r.tryReceive( result ), TryResult::Ok );
+    ASSERT_EQ( result, 1 );
+    ASSERT_TRUE( high.handle.done() );
+    ASSERT_EQ( r.tryReceive( result ), TryResult::Ok );
+    ASSERT_EQ( result, 9 );
+}
+
+int main( int argc, char** argv )
+{
+    ::testing::InitGoogleTest( &argc, argv );
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,145 @@
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <variant>
+
+#include <gtest/gtest.h>
+
+#include "dummy_coro.hpp"
+#include <cochan/cochan.hpp>
+
+using namespace cochan;
+
+MyCoroutine selectOnce( Receiver< int > a, Receiver< int > b, std::variant< std::optional< int >, std::optional< int > >& result )
+{
+    result = co_await select( a.receive(), b.receive() );
+}
+
+TEST( SelectTest, ParksOnAllAndCompletesOnce )
+{
+    auto [ sa, ra ] = makeChannel< int >( 1 );
+    auto [ sb, rb ] = makeChannel< int >( 1 );
+    std::variant< std::optional< int >, std::optional< int > > result;
+
+    auto selectCoro = selectOnce( ra, rb, result );
+    ASSERT_FALSE( selectCoro.handle.done() ) << "Select should park when no case is ready.";
+
+    drop( sendOne( sb, 42 ) );
+    ASSERT_TRUE( selectCoro.handle.done() );
+    ASSERT_EQ( result.index(), 1 );
+    ASSERT_EQ( std::get< 1 >( result ), 42 );
+
+    // The losing waiter is gone from the first channel, so a plain receive gets the next value
+    drop( sendOne( sa, 7 ) );
+    std::optional< int > value;
+    ASSERT_EQ( ra.tryReceive( value ), TryResult::Ok );
+    ASSERT_EQ( value, 7 );
+}
+
+TEST( SelectTest, ReadyCasesAreTakenInTurn )
+{
+    auto [ sa, ra ] = makeChannel< int >( 16 );
+    auto [ sb, rb ] = makeChannel< int >( 16 );
+    for( int i = 0; i < 8; i++ )
+    {
+        ASSERT_EQ( sa.trySend( i ), TryResult::Ok );
+        ASSERT_EQ( sb.trySend( i ), TryResult::Ok );
+    }
+
+    std::size_t fromA = 0;
+    std::size_t fromB = 0;
+    for( int i = 0; i < 8; i++ )
+    {
+        std::variant< std::optional< int >, std::optional< int > > result;
+        auto selectCoro = selectOnce( ra, rb, result );
+        ASSERT_TRUE( selectCoro.handle.done() ) << "Select should not park when a case is ready.";
+        ( result.index() == 0 ? fromA : fromB )++;
+    }
+
+    ASSERT_EQ( fromA, 4 );
+    ASSERT_EQ( fromB, 4 );
+}
+
+MyCoroutine selectSendOrReceive( Sender< int > out, Receiver< int > in, std::variant< bool, std::optional< int > >& result )
+{
+    result = co_await select( out.send( 1 ), in.receive() );
+}
+
+TEST( SelectTest, SendCaseAndClose )
+{
+    auto [ so, ro ] = makeChannel< int >( 0 );
+    auto [ si, ri ] = makeChannel< int >( 0 );
+    std::variant< bool, std::optional< int > > result;
+
+    auto selectCoro = selectSendOrReceive( so, ri, result );
+    ASSERT_FALSE( selectCoro.handle.done() );
+
+    drop( std::move( si ) );
+    ASSERT_TRUE( selectCoro.handle.done() ) << "Closing a receive case completes the select.";
+    ASSERT_EQ( result.index(), 1 );
+    ASSERT_FALSE( std::get< 1 >( result ) );
+
+    std::optional< int > value;
+    ASSERT_EQ( ro.tryReceive( value ), TryResult::Empty ) << "The send case must not have left its value behind.";
+}
+
+MyCoroutine selectLoop( Receiver< int > a, Receiver< int > b, int& sum )
+{
+    int closed = 0;
+    while( closed != 2 )
+    {
+        auto result = co_await select( a.receive(), b.receive() );
+        auto& value = result.index() == 0 ? std::get< 0 >( result ) : std::get< 1 >( result );
+        if( value )
+        {
+            sum += *value;
+        }
+        else
+        {
+            closed++;
+            if( closed == 2 )
+            {
+                break;
+            }
+
+            // Keep selecting on the open one only
+            auto& open = result.index() == 0 ? b : a;
+            while( auto rest = co_await open.receive() )
+            {
+                sum += *rest;
+            }
+
+            closed++;
+        }
+    }
+}
+
+TEST( SelectTest, MultiThread )
+{
+    constexpr int NUM_SEND_ITEMS = 2000;
+    auto [ sa, ra ] = makeChannel< int >( 2 );
+    auto [ sb, rb ] = makeChannel< int >( 0 );
+    int sum = 0;
+
+    std::thread receiver( [ &, ra = std::move( ra ), rb = std::move( rb ) ]() {
+        waitDone( selectLoop( ra, rb, sum ) );
+    } );
+    std::thread senderA( [ &, sa = std::move( sa ) ]() {
+        waitDone( sendCount( sa, NUM_SEND_ITEMS ) );
+    } );
+    std::thread senderB( [ &, sb = std::move( sb ) ]() {
+        waitDone( sendCount( sb, NUM_SEND_ITEMS ) );
+    } );
+
+    senderA.join();
+    senderB.join();
+    receiver.join();
+
+    ASSERT_EQ( sum, NUM_SEND_ITEMS * ( NUM_SEND_ITEMS - 1 ) );
+}
+
+int main( int argc, char** argv )
+{
+    ::testing::InitGoogleTest( &argc, argv );
+    return RUN_ALL_TESTS();
+}
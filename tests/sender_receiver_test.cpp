@@ -4,6 +4,9 @@
 
 #include <iostream>
 #include <thread>
+#include <span>
+#include <deque>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -40,11 +43,6 @@ MyCoroutine receive( Receiver< int > r, uint& receiveCounter )
     co_return;
 }
 
-template< class T >
-void drop( T t )
-{
-}
-
 class SenderReceiverLibcoroTest: public ::testing::Test
 {
   protected:
@@ -84,22 +82,33 @@ TEST_F( SenderReceiverLibcoroTest, SingleThreadReceiveSend )
     ASSERT_EQ( receiveCounter, NUM_SEND_ITEMS );
 }
 
+TEST_F( SenderReceiverLibcoroTest, SingleThreadRendezvous )
+{
+    auto [ s, r ] = makeChannel< int >( 0 );
+    ASSERT_EQ( s.getCapacity(), 0 );
+
+    auto sendCoro = send( std::move( s ) );
+    ASSERT_FALSE( sendCoro.handle.done() ) << "Sender should wait for receiver on rendezvous channel.";
+
+    auto receiveCoro = receive( std::move( r ), receiveCounter );
+
+    ASSERT_TRUE( sendCoro.handle.done() ) << "Coroutines should complete each other within 1 thread.";
+    drop( std::move( sendCoro ) );
+
+    ASSERT_TRUE( receiveCoro.handle.done() ) << "Coroutines should complete each other within 1 thread.";
+    ASSERT_EQ( receiveCounter, NUM_SEND_ITEMS );
+}
+
 void syncReceive( Receiver< int > r, uint& receiveCounter )
 {
     MyCoroutine coro = receive( std::move( r ), receiveCounter );
-    while( !coro.handle.done() )
-    {
-        std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
-    }
+    waitDone( coro );
 }
 
 void syncSend( Sender< int > s )
 {
     MyCoroutine coro = send( std::move( s ) );
-    while( !coro.handle.done() )
-    {
-        std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
-    }
+    waitDone( coro );
 }
 
 TEST_F( SenderReceiverLibcoroTest, MultiThreadSendReceive )
@@ -123,6 +132,339 @@ TEST_F( SenderReceiverLibcoroTest, MultiThreadSendReceive )
     ASSERT_EQ( receiveCounter, NUM_SEND_ITEMS );
 }
 
+TEST_F( SenderReceiverLibcoroTest, MultiThreadCapacityOne )
+{
+    const ScheduleFunc dumbSchedule = []( std::coroutine_handle<> handle ) {
+        std::thread t( [ handle ]() {
+            handle.resume();
+        } );
+
+        t.detach();
+    };
+
+    auto [ s, r ] = makeChannel< int >( 1, dumbSchedule );
+
+    std::thread st1( syncSend, s );
+    std::thread st2( syncSend, std::move( s ) );
+    std::thread rt( syncReceive, std::move( r ), std::ref( receiveCounter ) );
+
+    st1.join();
+    st2.join();
+    rt.join();
+
+    ASSERT_EQ( receiveCounter, 2 * NUM_SEND_ITEMS );
+}
+
+TEST_F( SenderReceiverLibcoroTest, MultiThreadRendezvous )
+{
+    const ScheduleFunc dumbSchedule = []( std::coroutine_handle<> handle ) {
+        std::thread t( [ handle ]() {
+            handle.resume();
+        } );
+
+        t.detach();
+    };
+
+    auto [ s, r ] = makeChannel< int >( 0, dumbSchedule );
+
+    std::thread st1( syncSend, s );
+    std::thread st2( syncSend, std::move( s ) );
+    std::thread rt( syncReceive, std::move( r ), std::ref( receiveCounter ) );
+
+    st1.join();
+    st2.join();
+    rt.join();
+
+    ASSERT_EQ( receiveCounter, 2 * NUM_SEND_ITEMS );
+}
+
+TEST_F( SenderReceiverLibcoroTest, DropSenderWakesAllParkedReceivers )
+{
+    constexpr uint NUM_RECEIVERS = 16;
+    auto [ s, r ] = makeChannel< int >( 3 );
+
+    std::vector< MyCoroutine > receivers;
+    for( uint i = 0; i < NUM_RECEIVERS; i++ )
+    {
+        receivers.emplace_back( receive( r, receiveCounter ) );
+    }
+
+    drop( std::move( r ) );
+    for( const auto& coro : receivers )
+    {
+        ASSERT_FALSE( coro.handle.done() ) << "Receivers should be parked on empty channel.";
+    }
+
+    drop( std::move( s ) );
+    for( const auto& coro : receivers )
+    {
+        ASSERT_TRUE( coro.handle.done() ) << "Dropping last sender should wake every parked receiver.";
+    }
+
+    ASSERT_EQ( receiveCounter, 0 );
+}
+
+TEST_F( SenderReceiverLibcoroTest, TrySendTryReceive )
+{
+    auto [ s, r ] = makeChannel< int >( 2 );
+    std::optional< int > value;
+
+    ASSERT_EQ( r.tryReceive( value ), TryResult::Empty );
+    ASSERT_EQ( s.trySend( 1 ), TryResult::Ok );
+    ASSERT_EQ( s.trySend( 2 ), TryResult::Ok );
+    ASSERT_EQ( s.trySend( 3 ), TryResult::Full );
+
+    ASSERT_EQ( r.tryReceive( value ), TryResult::Ok );
+    ASSERT_EQ( value, 1 );
+
+    drop( std::move( s ) );
+    ASSERT_EQ( r.tryReceive( value ), TryResult::Ok ) << "Queued values are still delivered after close.";
+    ASSERT_EQ( value, 2 );
+    ASSERT_EQ( r.tryReceive( value ), TryResult::Closed );
+}
+
+TEST_F( SenderReceiverLibcoroTest, TrySendHandsOffToParkedReceiver )
+{
+    auto [ s, r ] = makeChannel< int >( 0 );
+    ASSERT_EQ( s.trySend( 1 ), TryResult::Full ) << "Rendezvous channel without a receiver is full.";
+
+    auto receiveCoro = receive( r, receiveCounter );
+    ASSERT_EQ( s.trySend( 1 ), TryResult::Ok );
+    ASSERT_EQ( receiveCounter, 1 );
+
+    drop( std::move( r ) );
+    drop( std::move( s ) );
+    ASSERT_TRUE( receiveCoro.handle.done() );
+}
+
+TEST_F( SenderReceiverLibcoroTest, TrySendAfterReceiversDropped )
+{
+    auto [ s, r ] = makeChannel< int >( 2 );
+    drop( std::move( r ) );
+    ASSERT_EQ( s.trySend( 1 ), TryResult::Closed );
+}
+
+TEST_F( SenderReceiverLibcoroTest, ConcurrentCopiesAndDrops )
+{
+    constexpr int NUM_THREADS = 4;
+    constexpr int NUM_COPIES = 10000;
+    for( int round = 0; round < 20; round++ )
+    {
+        auto [ s, r ] = makeChannel< int >( 4 );
+        std::vector< std::thread > threads;
+        for( int i = 0; i < NUM_THREADS; i++ )
+        {
+            threads.emplace_back( [ s = s, r = r ]() {
+                for( int j = 0; j < NUM_COPIES; j++ )
+                {
+                    auto sender = s;
+                    auto receiver = r;
+                    drop( sender.send( j ) );
+                }
+            } );
+        }
+
+        // Whichever endpoint goes last destroys the channel
+        drop( std::move( s ) );
+        drop( std::move( r ) );
+        for( auto& thread : threads )
+        {
+            thread.join();
+        }
+    }
+}
+
+TEST_F( SenderReceiverLibcoroTest, MoreThan65535OwnersOfOneKind )
+{
+    constexpr uint NUM_COPIES = 100000;
+    constexpr uint NUM_PARKED = 70000;
+    auto [ s, r ] = makeChannel< int >( 1 );
+
+    std::vector< Receiver< int > > copies( NUM_COPIES, r );
+    std::vector< MyCoroutine > receivers;
+    receivers.reserve( NUM_PARKED );
+    for( uint i = 0; i < NUM_PARKED; i++ )
+    {
+        receivers.emplace_back( receive( r, receiveCounter ) );
+    }
+
+    for( const auto& coro : receivers )
+    {
+        ASSERT_FALSE( coro.handle.done() ) << "Receivers should be parked on empty channel.";
+    }
+
+    drop( std::move( s ) );
+    for( const auto& coro : receivers )
+    {
+        ASSERT_TRUE( coro.handle.done() ) << "Dropping last sender should wake every parked receiver.";
+    }
+
+    ASSERT_EQ( receiveCounter, 0 );
+    std::optional< int > value;
+    ASSERT_EQ( copies.back().tryReceive( value ), TryResult::Closed );
+}
+
+struct CountingScheduler
+{
+    void schedule( std::coroutine_handle<> handle )
+    {
+        ( *scheduled )++;
+        handle.resume();
+    }
+
+    uint* scheduled;
+};
+
+template< class Chan >
+MyCoroutine sendAll( Sender< int, Chan > s )
+{
+    for( uint i = 0; i < NUM_SEND_ITEMS; i++ )
+    {
+        co_await s.send( i );
+    }
+}
+
+template< class Chan >
+MyCoroutine receiveAll( Receiver< int, Chan > r, uint& receiveCounter )
+{
+    while( true )
+    {
+        auto val = co_await r.receive();
+        if( !val )
+        {
+            break;
+        }
+
+        receiveCounter++;
+    }
+}
+
+TEST_F( SenderReceiverLibcoroTest, SchedulerPolicy )
+{
+    static_assert( std::is_empty_v< InlineScheduler > );
+    static_assert( SchedulerPolicy< CountingScheduler > );
+
+    uint scheduled = 0;
+    auto [ s, r ] = makeChannel< int, CountingScheduler >( 1, CountingScheduler{ &scheduled } );
+
+    auto receiveCoro = receiveAll( std::move( r ), receiveCounter );
+    auto sendCoro = sendAll( std::move( s ) );
+    drop( std::move( sendCoro ) );
+
+    ASSERT_TRUE( receiveCoro.handle.done() );
+    ASSERT_EQ( receiveCounter, NUM_SEND_ITEMS );
+    ASSERT_GT( scheduled, 0 ) << "Wakeups should go through the policy.";
+}
+
+struct BatchingScheduler
+{
+    void schedule( std::coroutine_handle<> handle )
+    {
+        handle.resume();
+    }
+
+    void scheduleBatch( std::span< std::coroutine_handle<> > handles )
+    {
+        batches->push_back( handles.size() );
+        for( auto handle : handles )
+        {
+            handle.resume();
+        }
+    }
+
+    std::vector< std::size_t >* batches;
+};
+
+TEST_F( SenderReceiverLibcoroTest, DropSenderSchedulesParkedReceiversInOneBatch )
+{
+    static_assert( BatchSchedulerPolicy< BatchingScheduler > );
+
+    constexpr uint NUM_RECEIVERS = 16;
+    std::vector< std::size_t > batches;
+    auto [ s, r ] = makeChannel< int, BatchingScheduler >( 3, BatchingScheduler{ &batches } );
+
+    std::vector< MyCoroutine > receivers;
+    for( uint i = 0; i < NUM_RECEIVERS; i++ )
+    {
+        receivers.emplace_back( receiveAll( r, receiveCounter ) );
+    }
+
+    drop( std::move( r ) );
+    drop( std::move( s ) );
+    for( const auto& coro : receivers )
+    {
+        ASSERT_TRUE( coro.handle.done() );
+    }
+
+    ASSERT_EQ( batches, std::vector< std::size_t >{ NUM_RECEIVERS } );
+}
+
+struct QueueingHandOffScheduler
+{
+    static constexpr bool handOff = true;
+
+    void schedule( std::coroutine_handle<> handle )
+    {
+        queue->push_back( handle );
+    }
+
+    std::deque< std::coroutine_handle<> >* queue;
+};
+
+MyCoroutine receiveOne( Receiver< int, Channel< int, MpmcRing< int >, QueueingHandOffScheduler > > r, std::optional< int >& result )
+{
+    result = co_await r.receive();
+}
+
+MyCoroutine sendOne( Sender< int, Channel< int, MpmcRing< int >, QueueingHandOffScheduler > > s, int value, bool& sent )
+{
+    co_await s.send( value );
+    sent = true;
+}
+
+TEST_F( SenderReceiverLibcoroTest, HandOffTransfersToWokenReceiver )
+{
+    static_assert( HandOffSchedulerPolicy< QueueingHandOffScheduler > );
+
+    std::deque< std::coroutine_handle<> > queue;
+    for( std::size_t capacity : { 0, 1 } )
+    {
+        auto [ s, r ] = makeChannel< int, QueueingHandOffScheduler >( capacity, QueueingHandOffScheduler{ &queue } );
+
+        std::optional< int > result;
+        auto receiveCoro = receiveOne( r, result );
+        ASSERT_FALSE( receiveCoro.handle.done() );
+
+        bool sent = false;
+        auto sendCoro = sendOne( s, 42, sent );
+        ASSERT_TRUE( receiveCoro.handle.done() ) << "Receiver should run on the sender's thread right away.";
+        ASSERT_EQ( result, 42 );
+
+        ASSERT_FALSE( sent ) << "Sender should have gone to the scheduler.";
+        ASSERT_EQ( queue.size(), 1 );
+        queue.front().resume();
+        queue.pop_front();
+        ASSERT_TRUE( sent );
+
+        // Nobody to wake: no transfer and no detour through the scheduler
+        sent = false;
+        auto bufferedCoro = sendOne( s, 7, sent );
+        ASSERT_EQ( sent, capacity != 0 );
+        ASSERT_EQ( queue.size(), 0 );
+
+        std::optional< int > value;
+        ASSERT_EQ( r.tryReceive( value ), TryResult::Ok );
+        ASSERT_EQ( value, 7 );
+        while( !queue.empty() )
+        {
+            queue.front().resume();
+            queue.pop_front();
+        }
+
+        ASSERT_TRUE( sent );
+    }
+}
+
 int main( int argc, char** argv )
 {
     ::testing::InitGoogleTest( &argc, argv );
@@ -0,0 +1,88 @@
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dummy_coro.hpp"
+#include <cochan/cochan.hpp>
+
+using namespace cochan;
+
+void expectInOrder( const std::vector< int >& received, int numSent )
+{
+    ASSERT_EQ( received.size(), numSent );
+    for( int i = 0; i < numSent; i++ )
+    {
+        ASSERT_EQ( received[ i ], i );
+    }
+}
+
+TEST( SpscChannelTest, SingleThreadSendReceive )
+{
+    constexpr int NUM_SEND_ITEMS = 100;
+    std::vector< int > received;
+    auto [ s, r ] = makeSpscChannel< int >( 3 );
+
+    auto sendCoro = sendCount( std::move( s ), NUM_SEND_ITEMS );
+    ASSERT_FALSE( sendCoro.handle.done() ) << "Sender should park on full channel.";
+
+    auto receiveCoro = receiveInto( std::move( r ), received );
+    ASSERT_TRUE( sendCoro.handle.done() ) << "Coroutines should complete each other within 1 thread.";
+    drop( std::move( sendCoro ) );
+
+    ASSERT_TRUE( receiveCoro.handle.done() ) << "Coroutines should complete each other within 1 thread.";
+    expectInOrder( received, NUM_SEND_ITEMS );
+}
+
+TEST( SpscChannelTest, SingleThreadReceiveSend )
+{
+    constexpr int NUM_SEND_ITEMS = 100;
+    std::vector< int > received;
+    auto [ s, r ] = makeSpscChannel< int >( 4 );
+
+    auto receiveCoro = receiveInto( std::move( r ), received );
+    ASSERT_FALSE( receiveCoro.handle.done() ) << "Receiver should park on empty channel.";
+
+    auto sendCoro = sendCount( std::move( s ), NUM_SEND_ITEMS );
+    ASSERT_TRUE( sendCoro.handle.done() ) << "Coroutines should complete each other within 1 thread.";
+    drop( std::move( sendCoro ) );
+
+    ASSERT_TRUE( receiveCoro.handle.done() ) << "Coroutines should complete each other within 1 thread.";
+    expectInOrder( received, NUM_SEND_ITEMS );
+}
+
+TEST( SpscChannelTest, MultiThreadSendReceive )
+{
+    constexpr int NUM_SEND_ITEMS = 20000;
+    const ScheduleFunc dumbSchedule = []( std::coroutine_handle<> handle ) {
+        std::thread t( [ handle ]() {
+            handle.resume();
+        } );
+
+        t.detach();
+    };
+
+    std::vector< int > received;
+    auto [ s, r ] = makeSpscChannel< int >( 16, dumbSchedule );
+
+    std::thread st( [ s = std::move( s ) ]() mutable {
+        MyCoroutine coro = sendCount( std::move( s ), NUM_SEND_ITEMS );
+        waitDone( coro );
+    } );
+
+    std::thread rt( [ r = std::move( r ), &received ]() mutable {
+        MyCoroutine coro = receiveInto( std::move( r ), received );
+        waitDone( coro );
+    } );
+
+    st.join();
+    rt.join();
+
+    expectInOrder( received, NUM_SEND_ITEMS );
+}
+
+int main( int argc, char** argv )
+{
+    ::testing::InitGoogleTest( &argc, argv );
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,166 @@
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dummy_coro.hpp"
+#include <cochan/cochan.hpp>
+
+using namespace cochan;
+
+using CountedChannel = Channel< int, MpmcRing< int >, ScheduleFunc, ChannelStats >;
+
+static_assert( sizeof( Channel< int > ) < sizeof( CountedChannel ), "ChannelStats should add its counters." );
+static_assert( sizeof( Channel< int >::SendWaiter ) == sizeof( WaiterNode< int > ), "NoStats should not stamp waiters." );
+
+TEST( StatsTest, CountsQueuedTraffic )
+{
+    auto [ s, r ] = makeChannel< int, ScheduleFunc, ChannelStats >( 4 );
+    for( int i = 0; i < 3; i++ )
+    {
+        ASSERT_EQ( s.trySend( i ), TryResult::Ok );
+    }
+
+    std::optional< int > result;
+    ASSERT_EQ( r.tryReceive( result ), TryResult::Ok );
+
+    const auto stats = s.stats();
+    ASSERT_EQ( stats.sends, 3 );
+    ASSERT_EQ( stats.receives, 1 );
+    ASSERT_EQ( stats.highWaterMark, 3 );
+    ASSERT_EQ( stats.senderParks, 0 );
+    ASSERT_EQ( stats.receiverParks, 0 );
+    ASSERT_EQ( stats.wakeups, 0 );
+}
+
+TEST( StatsTest, CountsParksAndWakeups )
+{
+    auto [ s, r ] = makeChannel< int, ScheduleFunc, ChannelStats >( 1 );
+    std::vector< int > received;
+    auto receiveCoro = receiveInto( r, received );
+    ASSERT_EQ( r.stats().receiverParks, 1 );
+
+    // Each value is handed straight to the parked receiver, which parks again right away
+    {
+        auto first = sendOne( s, 1 );
+        auto second = sendOne( s, 2 );
+        ASSERT_TRUE( first.handle.done() );
+        ASSERT_TRUE( second.handle.done() );
+    }
+
+    std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    drop( std::move( s ) );
+    ASSERT_TRUE( receiveCoro.handle.done() );
+    ASSERT_EQ( received, ( std::vector< int >{ 1, 2 } ) );
+
+    const auto stats = r.stats();
+    ASSERT_EQ( stats.sends, 2 );
+    ASSERT_EQ( stats.receives, 2 );
+    ASSERT_EQ( stats.receiverParks, 3 );
+    ASSERT_EQ( stats.wakeups, 3 );
+    ASSERT_EQ( stats.closeReleases, 1 ) << "Last sender gone should release the parked receiver.";
+    ASSERT_GE( stats.parkedTime, std::chrono::milliseconds( 1 ) );
+}
+
+TEST( StatsTest, CountsParkedSenders )
+{
+    auto [ s, r ] = makeChannel< int, ScheduleFunc, ChannelStats >( 1 );
+    auto first = sendOne( s, 1 );
+    auto second = sendOne( s, 2 );
+    ASSERT_FALSE( second.handle.done() );
+    ASSERT_EQ( s.stats().senderParks, 1 );
+
+    std::optional< int > result;
+    ASSERT_EQ( r.tryReceive( result ), TryResult::Ok );
+    ASSERT_TRUE( second.handle.done() ) << "Freed slot should take parked sender's value.";
+
+    const auto stats = s.stats();
+    ASSERT_EQ( stats.sends, 2 );
+    ASSERT_EQ( stats.wakeups, 1 );
+    ASSERT_EQ( stats.highWaterMark, 1 );
+}
+
+TEST( StatsTest, ConcurrentTotalsAddUp )
+{
+    constexpr int perThread = 2000;
+    auto [ s, r ] = makeChannel< int, ScheduleFunc, ChannelStats >( 16 );
+
+    std::vector< std::thread > threads;
+    for( int t = 0; t < 2; t++ )
+    {
+        threads.emplace_back( [ sender = s ]() mutable {
+            for( int i = 0; i < perThread; i++ )
+            {
+                while( sender.trySend( i ) != TryResult::Ok )
+                {
+                    std::this_thread::yield();
+                }
+            }
+        } );
+    }
+
+    int received = 0;
+    std::optional< int > result;
+    while( received < 2 * perThread )
+    {
+        if( r.tryReceive( result ) == TryResult::Ok )
+        {
+            received++;
+        }
+    }
+
+    for( auto& thread : threads )
+    {
+        thread.join();
+    }
+
+    const auto stats = r.stats();
+    ASSERT_EQ( stats.sends, 2 * perThread );
+    ASSERT_EQ( stats.receives, 2 * perThread );
+    ASSERT_LE( stats.highWaterMark, 16 );
+}
+
+TEST( StatsTest, ProfilesLockPerSite )
+{
+    using ProfiledChannel = Channel< int, MpmcRing< int >, ScheduleFunc, ContentionStats >;
+    auto [ s, r ] = makeChannel< int, ScheduleFunc, ContentionStats >( 1 );
+    auto receiveCoro = []( Receiver< int, ProfiledChannel > receiver ) -> MyCoroutine {
+        while( true )
+        {
+            auto value = co_await receiver.receive();
+            if( !value )
+            {
+                break;
+            }
+        }
+    }( r );
+
+    ASSERT_EQ( s.trySend( 1 ), TryResult::Ok );
+    auto locks = r.stats().locks;
+    ASSERT_EQ( locks[ static_cast< std::size_t >( LockSite::HandleReceive ) ].acquisitions, 2 ) << "Receiver parks before and after the value.";
+    ASSERT_EQ( locks[ static_cast< std::size_t >( LockSite::ReleaseReceivers ) ].acquisitions, 1 );
+    ASSERT_EQ( locks[ static_cast< std::size_t >( LockSite::DropSender ) ].acquisitions, 0 );
+
+    drop( std::move( s ) );
+    ASSERT_TRUE( receiveCoro.handle.done() );
+
+    locks = r.stats().locks;
+    ASSERT_EQ( locks[ static_cast< std::size_t >( LockSite::DropSender ) ].acquisitions, 1 ) << "Only the last sender should lock.";
+    for( const auto& site : locks )
+    {
+        std::uint64_t held = 0;
+        for( const auto count : site.holdHistogram )
+        {
+            held += count;
+        }
+
+        ASSERT_EQ( held, site.acquisitions );
+        ASSERT_EQ( site.contended, 0 );
+    }
+}
+
+int main( int argc, char** argv )
+{
+    ::testing::InitGoogleTest( &argc, argv );
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,151 @@
+#include <chrono>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "dummy_coro.hpp"
+#include <cochan/cochan.hpp>
+
+using namespace cochan;
+using namespace std::chrono_literals;
+
+MyCoroutine receiveFor( Receiver< int > r, std::chrono::milliseconds timeout, ReceiveResult< int >& result )
+{
+    result = co_await r.receiveFor( timeout );
+}
+
+MyCoroutine sendFor( Sender< int > s, int value, std::chrono::milliseconds timeout, TryResult& result )
+{
+    result = co_await s.sendFor( value, timeout );
+}
+
+TEST( TimeoutTest, ReceiveTimesOut )
+{
+    auto [ s, r ] = makeChannel< int >( 1 );
+    ReceiveResult< int > result{ TryResult::Ok, std::nullopt };
+
+    const auto start = std::chrono::steady_clock::now();
+    auto receiveCoro = receiveFor( r, 20ms, result );
+    ASSERT_FALSE( isDone( receiveCoro ) );
+    waitDone( receiveCoro );
+
+    ASSERT_GE( std::chrono::steady_clock::now() - start, 20ms ) << "Timer fired before the deadline.";
+    ASSERT_EQ( result.status, TryResult::TimedOut );
+    ASSERT_FALSE( result.value );
+
+    // The timed out waiter is gone, so the value stays in the channel
+    ASSERT_EQ( s.trySend( 1 ), TryResult::Ok );
+    std::optional< int > value;
+    ASSERT_EQ( r.tryReceive( value ), TryResult::Ok );
+    ASSERT_EQ( value, 1 );
+}
+
+TEST( TimeoutTest, ReceiveBeforeDeadline )
+{
+    auto [ s, r ] = makeChannel< int >( 0 );
+    ReceiveResult< int > result{ TryResult::TimedOut, std::nullopt };
+
+    auto receiveCoro = receiveFor( r, 10s, result );
+    ASSERT_FALSE( receiveCoro.handle.done() );
+
+    ASSERT_EQ( s.trySend( 42 ), TryResult::Ok );
+    ASSERT_TRUE( receiveCoro.handle.done() ) << "Hand-off should not wait for the timer.";
+    ASSERT_EQ( result.status, TryResult::Ok );
+    ASSERT_EQ( result.value, 42 );
+
+    drop( std::move( s ) );
+    auto closedCoro = receiveFor( r, 10s, result );
+    ASSERT_TRUE( closedCoro.handle.done() );
+    ASSERT_EQ( result.status, TryResult::Closed );
+}
+
+TEST( TimeoutTest, SendTimesOut )
+{
+    auto [ s, r ] = makeChannel< int >( 0 );
+    TryResult result = TryResult::Ok;
+
+    auto sendCoro = sendFor( s, 1, 20ms, result );
+    ASSERT_FALSE( isDone( sendCoro ) );
+    waitDone( sendCoro );
+    ASSERT_EQ( result, TryResult::TimedOut );
+
+    std::optional< int > value;
+    ASSERT_EQ( r.tryReceive( value ), TryResult::Empty ) << "Timed out value must not be delivered.";
+
+    auto handedCoro = sendFor( s, 2, 10s, result );
+    ASSERT_FALSE( handedCoro.handle.done() );
+    ASSERT_EQ( r.tryReceive( value ), TryResult::Ok );
+    ASSERT_EQ( value, 2 );
+    ASSERT_TRUE( handedCoro.handle.done() );
+    ASSERT_EQ( result, TryResult::Ok );
+}
+
+MyCoroutine receiveOnce( Receiver< int > r, std::optional< int >& result )
+{
+    result = co_await r.receive();
+}
+
+TEST( TimeoutTest, CloseReleasesTimedAndPlainReceivers )
+{
+    auto [ s, r ] = makeChannel< int >( 1 );
+    ReceiveResult< int > timed{ TryResult::Ok, std::nullopt };
+    std::optional< int > plain = 0;
+
+    auto plainCoro = receiveOnce( r, plain );
+    auto timedCoro = receiveFor( r, 10s, timed );
+    drop( std::move( r ) );
+    ASSERT_FALSE( plainCoro.handle.done() );
+    ASSERT_FALSE( timedCoro.handle.done() );
+
+    drop( std::move( s ) );
+    ASSERT_TRUE( plainCoro.handle.done() );
+    ASSERT_TRUE( timedCoro.handle.done() );
+    ASSERT_FALSE( plain );
+    ASSERT_EQ( timed.status, TryResult::Closed );
+}
+
+MyCoroutine racingReceiver( Receiver< int > r, int& received, int& timedOut )
+{
+    while( true )
+    {
+        auto result = co_await r.receiveFor( 1ms );
+        if( result.status == TryResult::Closed )
+        {
+            break;
+        }
+
+        ( result.status == TryResult::Ok ? received : timedOut )++;
+    }
+}
+
+TEST( TimeoutTest, RacesWithSenders )
+{
+    constexpr int NUM_SEND_ITEMS = 2000;
+    auto [ s, r ] = makeChannel< int >( 0 );
+    int received = 0;
+    int timedOut = 0;
+
+    std::thread receiver( [ &, r = std::move( r ) ]() {
+        waitDone( racingReceiver( r, received, timedOut ) );
+    } );
+
+    std::thread sender( [ s = std::move( s ) ]() mutable {
+        for( int i = 0; i < NUM_SEND_ITEMS; i++ )
+        {
+            while( s.trySend( i ) != TryResult::Ok )
+            {
+                std::this_thread::yield();
+            }
+        }
+    } );
+
+    sender.join();
+    receiver.join();
+    ASSERT_EQ( received, NUM_SEND_ITEMS ) << "Timed out receives must not lose values.";
+}
+
+int main( int argc, char** argv )
+{
+    ::testing::InitGoogleTest( &argc, argv );
+    return RUN_ALL_TESTS();
+}
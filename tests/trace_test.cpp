@@ -0,0 +1,110 @@
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dummy_coro.hpp"
+#include <cochan/cochan.hpp>
+
+using namespace cochan;
+
+static_assert( traceEnabled, "trace_test is built with COCHAN_TRACE." );
+
+std::size_t countOf( const std::string& text, const std::string& pattern )
+{
+    std::size_t count = 0;
+    for( auto position = text.find( pattern ); position != std::string::npos; position = text.find( pattern, position + 1 ) )
+    {
+        count++;
+    }
+
+    return count;
+}
+
+TEST( TraceTest, RecordsParkWakeAndClose )
+{
+    TraceRegistry::instance().clear();
+
+    auto [ s, r ] = makeChannel< int >( 1 );
+    std::vector< int > received;
+    auto receiveCoro = receiveInto( std::move( r ), received );
+    ASSERT_EQ( s.trySend( 1 ), TryResult::Ok );
+    drop( std::move( s ) );
+    ASSERT_TRUE( receiveCoro.handle.done() );
+
+    std::ostringstream out;
+    dumpChromeTrace( out );
+    const auto trace = out.str();
+
+    // Parked twice: before the value and after it, until the close
+    ASSERT_EQ( countOf( trace, "\"ph\":\"b\"" ), 2 );
+    ASSERT_EQ( countOf( trace, "\"ph\":\"e\"" ), 2 );
+    ASSERT_EQ( countOf( trace, "\"name\":\"close\"" ), 1 );
+    ASSERT_EQ( countOf( trace, "\"side\":\"receive\"" ), 2 );
+    ASSERT_EQ( trace.front(), '{' );
+    ASSERT_EQ( trace.substr( trace.size() - 4 ), "\n]}\n" );
+}
+
+TEST( TraceTest, ThreadsGetTheirOwnBuffers )
+{
+    TraceRegistry::instance().clear();
+
+    auto [ s, r ] = makeChannel< int >( 1 );
+    std::vector< int > received;
+    auto receiveCoro = receiveInto( std::move( r ), received );
+
+    std::thread( [ sender = std::move( s ) ]() mutable {
+        ASSERT_EQ( sender.trySend( 1 ), TryResult::Ok );
+    } ).join();
+
+    ASSERT_TRUE( receiveCoro.handle.done() );
+    ASSERT_EQ( received, ( std::vector< int >{ 1 } ) );
+
+    std::ostringstream out;
+    dumpChromeTrace( out );
+    const auto trace = out.str();
+    ASSERT_NE( trace.find( "\"tid\":0" ), std::string::npos );
+    ASSERT_NE( trace.find( "\"tid\":1" ), std::string::npos ) << "Wake and close on the sender's thread should go to a second buffer.";
+}
+
+TEST( TraceTest, ExitedThreadsHandTheirBuffersOn )
+{
+    constexpr int NUM_THREADS = 50;
+    TraceRegistry::instance().clear();
+
+    for( int i = 0; i < NUM_THREADS; i++ )
+    {
+        std::thread( [] {
+            traceEvent( TraceKind::Close, nullptr, nullptr, 0 );
+        } ).join();
+    }
+
+    std::ostringstream out;
+    dumpChromeTrace( out );
+    const auto trace = out.str();
+    ASSERT_EQ( countOf( trace, "\"name\":\"close\"" ), NUM_THREADS ) << "Events of exited threads should still be dumped.";
+    ASSERT_EQ( trace.find( "\"tid\":2" ), std::string::npos ) << "One thread at a time should not need more than one extra buffer.";
+}
+
+TEST( TraceTest, BufferKeepsLatestEvents )
+{
+    TraceBuffer buffer;
+    for( std::size_t i = 0; i < TraceBuffer::capacity + 10; i++ )
+    {
+        buffer.record( TraceKind::Wake, nullptr, nullptr, i );
+    }
+
+    std::vector< TraceEvent > events;
+    buffer.collect( events );
+    ASSERT_EQ( events.size(), TraceBuffer::capacity );
+    ASSERT_EQ( events.front().depth, 10 );
+    ASSERT_EQ( events.back().depth, TraceBuffer::capacity + 9 );
+}
+
+int main( int argc, char** argv )
+{
+    ::testing::InitGoogleTest( &argc, argv );
+    return RUN_ALL_TESTS();
+}
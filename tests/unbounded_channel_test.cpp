@@ -0,0 +1,75 @@
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dummy_coro.hpp"
+#include <cochan/cochan.hpp>
+
+using namespace cochan;
+
+TEST( UnboundedChannelTest, SenderNeverParks )
+{
+    constexpr int NUM_SEND_ITEMS = 1000;
+    std::vector< int > received;
+    auto [ s, r ] = makeUnboundedChannel< int >( { .segmentSize = 7 } );
+
+    auto sendCoro = sendCount( s, NUM_SEND_ITEMS );
+    ASSERT_TRUE( sendCoro.handle.done() ) << "Sender should never park on unbounded channel.";
+    ASSERT_EQ( s.getCapacity(), std::numeric_limits< std::size_t >::max() );
+    drop( std::move( s ) );
+
+    auto receiveCoro = receiveInto( std::move( r ), received );
+    drop( std::move( sendCoro ) );
+    ASSERT_TRUE( receiveCoro.handle.done() );
+
+    ASSERT_EQ( received.size(), NUM_SEND_ITEMS );
+    for( int i = 0; i < NUM_SEND_ITEMS; i++ )
+    {
+        ASSERT_EQ( received[ i ], i );
+    }
+}
+
+TEST( UnboundedChannelTest, ReceiverWokenBySender )
+{
+    constexpr int NUM_SEND_ITEMS = 100;
+    std::vector< int > received;
+    auto [ s, r ] = makeUnboundedChannel< int >( { .segmentSize = 4 } );
+
+    auto receiveCoro = receiveInto( std::move( r ), received );
+    ASSERT_FALSE( receiveCoro.handle.done() ) << "Receiver should park on empty channel.";
+
+    auto sendCoro = sendCount( std::move( s ), NUM_SEND_ITEMS );
+    drop( std::move( sendCoro ) );
+    ASSERT_TRUE( receiveCoro.handle.done() );
+    ASSERT_EQ( received.size(), NUM_SEND_ITEMS );
+}
+
+TEST( UnboundedChannelTest, SoftLimitCallback )
+{
+    std::vector< std::size_t > crossings;
+    std::vector< int > received;
+    auto [ s, r ] = makeUnboundedChannel< int >( {
+        .segmentSize = 4,
+        .softLimit = 10,
+        .onSoftLimit =
+            [ & ]( std::size_t size ) {
+                crossings.push_back( size );
+            },
+    } );
+
+    drop( sendCount( s, 10 ) );
+    ASSERT_TRUE( crossings.empty() ) << "Reaching soft limit is not crossing it.";
+
+    drop( sendCount( s, 5 ) );
+    ASSERT_EQ( crossings, std::vector< std::size_t >{ 11 } );
+
+    drop( std::move( s ) );
+    drop( receiveInto( std::move( r ), received ) );
+    ASSERT_EQ( received.size(), 15 );
+}
+
+int main( int argc, char** argv )
+{
+    ::testing::InitGoogleTest( &argc, argv );
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,144 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dummy_coro.hpp"
+#include <cochan/cochan.hpp>
+
+using namespace cochan;
+
+template< class Scheduler >
+MyCoroutine watch( WatchReceiver< int, Scheduler > r, std::vector< int >& seen )
+{
+    while( true )
+    {
+        const bool changed = co_await r.changed();
+        if( !changed )
+        {
+            break;
+        }
+
+        seen.push_back( *r.borrow() );
+    }
+}
+
+struct CountingScheduler
+{
+    void schedule( std::coroutine_handle<> handle )
+    {
+        ( *single )++;
+        handle.resume();
+    }
+
+    void scheduleBatch( std::span< std::coroutine_handle<> > handles )
+    {
+        ( *batches )++;
+        for( auto handle : handles )
+        {
+            handle.resume();
+        }
+    }
+
+    int* single;
+    int* batches;
+};
+
+TEST( WatchTest, OnlyLatestValueIsSeen )
+{
+    auto [ s, r ] = makeWatch< int >( 0 );
+    ASSERT_FALSE( r.hasChanged() );
+    ASSERT_EQ( *r.borrow(), 0 );
+
+    s.send( 1 );
+    s.send( 2 );
+    s.send( 3 );
+    ASSERT_TRUE( r.hasChanged() );
+
+    std::vector< int > seen;
+    auto watchCoro = watch< ScheduleFunc >( std::move( r ), seen );
+    ASSERT_EQ( seen, std::vector< int >{ 3 } ) << "Intermediate values should be skipped.";
+
+    s.send( 4 );
+    ASSERT_EQ( seen, ( std::vector< int >{ 3, 4 } ) );
+
+    drop( std::move( s ) );
+    ASSERT_TRUE( watchCoro.handle.done() ) << "Dropping the sender should release watchers.";
+}
+
+TEST( WatchTest, SnapshotOutlivesUpdate )
+{
+    auto [ s, r ] = makeWatch< std::string >( "first" );
+    auto snapshot = r.borrow();
+    s.send( "second" );
+
+    ASSERT_EQ( *snapshot, "first" );
+    ASSERT_EQ( *r.borrow(), "second" );
+    ASSERT_EQ( *s.subscribe().borrow(), "second" );
+}
+
+TEST( WatchTest, WatchersReleasedInOneBatch )
+{
+    constexpr int NUM_WATCHERS = 5;
+    int single = 0;
+    int batches = 0;
+    auto [ s, r ] = makeWatch< int, CountingScheduler >( 0, CountingScheduler{ &single, &batches } );
+
+    std::vector< std::vector< int > > seen( NUM_WATCHERS );
+    std::vector< MyCoroutine > watchers;
+    for( int i = 0; i < NUM_WATCHERS; i++ )
+    {
+        watchers.push_back( watch( r, seen[ i ] ) );
+    }
+
+    s.send( 1 );
+    ASSERT_EQ( batches, 1 );
+    ASSERT_EQ( single, 0 );
+    for( const auto& values : seen )
+    {
+        ASSERT_EQ( values, std::vector< int >{ 1 } );
+    }
+
+    drop( std::move( s ) );
+    ASSERT_EQ( batches, 2 );
+    for( const auto& watcher : watchers )
+    {
+        ASSERT_TRUE( watcher.handle.done() );
+    }
+}
+
+TEST( WatchTest, MultiThread )
+{
+    constexpr int NUM_SEND_ITEMS = 20000;
+    auto [ s, r ] = makeWatch< int >( 0 );
+
+    std::vector< int > seen;
+    std::thread rt( [ r = std::move( r ), &seen ]() mutable {
+        MyCoroutine coro = watch< ScheduleFunc >( std::move( r ), seen );
+        waitDone( coro );
+    } );
+
+    std::thread st( [ s = std::move( s ) ]() mutable {
+        for( int i = 1; i <= NUM_SEND_ITEMS; i++ )
+        {
+            s.send( i );
+        }
+    } );
+
+    st.join();
+    rt.join();
+
+    ASSERT_FALSE( seen.empty() );
+    ASSERT_EQ( seen.back(), NUM_SEND_ITEMS );
+    for( std::size_t i = 1; i < seen.size(); i++ )
+    {
+        ASSERT_LT( seen[ i - 1 ], seen[ i ] );
+    }
+}
+
+int main( int argc, char** argv )
+{
+    ::testing::InitGoogleTest( &argc, argv );
+    return RUN_ALL_TESTS();
+}